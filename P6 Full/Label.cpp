@@ -1,19 +1,58 @@
 # include <ostream>
 # include <iostream>
+# include <cassert>
 # include "Label.h"
+# include "machine.h"
+# include "storage.h"
 
 using namespace std;
 
-unsigned Label::_counter = 0;
+thread_local const string *Label::_function = nullptr;
+thread_local unsigned Label::_counter = 0;
 
 Label::Label() {
+    assert(_function != nullptr);
+    _owner = _function;
     _number = _counter ++;
 }
 
+Label::Label(const string &owner, unsigned number) {
+    _owner = &owner;
+    _number = number;
+}
+
+void *Label::operator new(size_t size) {
+    return obtain(size, destroy<Label>);
+}
+
+void Label::operator delete(void *label) {
+    discard(label);
+}
+
+const string &Label::owner() const{
+    return *_owner;
+}
+
 unsigned Label::number() const{
     return _number;
 }
 
 ostream&operator <<(ostream&ostr, const Label &label) {
-    return ostr<< ".L" << label.number();
+    return ostr<< label_prefix << label.owner() << "." << label.number();
+}
+
+/*
+ * Function:	Label::enter
+ *
+ * Description:	Start numbering the labels of the given function afresh.
+ *		Labels are numbered separately within each function and
+ *		qualified by its name, so a label depends neither on the
+ *		order in which code for the functions is generated nor on
+ *		the other functions in the file.  The numbering is local
+ *		to each thread.
+ */
+
+void Label::enter(const string &function) {
+    _function = &function;
+    _counter = 0;
 }
@@ -1,13 +1,22 @@
 # ifndef LABEL_H
 # define LABEL_H
 
+# include <string>
 # include <ostream>
 class Label {
-    static unsigned _counter;
+    static thread_local const std::string *_function;
+    static thread_local unsigned _counter;
+    const std::string *_owner;
     unsigned _number;
 public:
     Label();
+    Label(const std::string &owner, unsigned number);
+    static void *operator new(size_t size);
+    static void operator delete(void *label);
+    const std::string &owner() const;
     unsigned number() const;
+
+    static void enter(const std::string &function);
 };
 
 std::ostream&operator <<(std::ostream &ostr, const Label &label);
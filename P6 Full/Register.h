@@ -2,24 +2,34 @@
  * File:	Register.h
  *
  * Description:	This file contains the class definition for registers on
- *		the Intel 32-bit processor.  Each integer register has two
- *		operand names depending upon the access size.
+ *		the Intel 32-bit processor and x86-64.  Each integer
+ *		register has up to three operand names depending upon the
+ *		access size.
+ *
+ *		Besides the expression currently assigned to a register,
+ *		we also remember the signature of the value it last held
+ *		and the symbols that value depends upon, so that the code
+ *		generator can reuse it instead of computing it again.
  */
 
 # ifndef REGISTER_H
 # define REGISTER_H
 # include <string>
+# include <vector>
 # include <ostream>
 
 class Register {
     typedef std::string string;
     string _name;
     string _byte;
+    string _quad;
 
 public:
     class Expression *_node;
+    string _value;
+    std::vector<const class Symbol *> _refs;
 
-    Register(const string &name, const string &byte = "");
+    Register(const string &name, const string &byte = "", const string &quad = "");
     const string &name(unsigned size = 0) const;
     const string &byte() const;
 };
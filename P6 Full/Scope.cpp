@@ -11,10 +11,12 @@
  *
  *		Extra functionality:
  *		- retrieving the vector of symbols
+ *		- finding symbols by name in constant time
  */
 
 # include <cassert>
 # include "Scope.h"
+# include "storage.h"
 
 
 /*
@@ -29,6 +31,24 @@ Scope::Scope(Scope *enclosing)
 }
 
 
+/*
+ * Functions:	Scope::operator new, Scope::operator delete
+ *
+ * Description:	Allocate and free a scope in the storage of the current
+ *		compilation.
+ */
+
+void *Scope::operator new(size_t size)
+{
+    return obtain(size, destroy<Scope>);
+}
+
+void Scope::operator delete(void *scope)
+{
+    discard(scope);
+}
+
+
 /*
  * Function:	Scope::insert
  *
@@ -41,6 +61,7 @@ void Scope::insert(Symbol *symbol)
 {
     assert(find(symbol->name()) == nullptr);
     _symbols.push_back(symbol);
+    _index[symbol->name()] = symbol;
 }
 
 
@@ -53,11 +74,9 @@ void Scope::insert(Symbol *symbol)
 
 Symbol *Scope::find(const string &name) const
 {
-    for (auto symbol : _symbols)
-	if (name == symbol->name())
-	    return symbol;
+    auto it = _index.find(name);
 
-    return nullptr;
+    return it != _index.end() ? it->second : nullptr;
 }
 
 
@@ -73,6 +92,7 @@ void Scope::remove(const string &name)
     for (unsigned i = 0; i < _symbols.size(); i ++)
 	if (name == _symbols[i]->name()) {
 	    _symbols.erase(_symbols.begin() + i);
+	    _index.erase(name);
 	    break;
 	}
 }
@@ -7,6 +7,8 @@
  */
 
 # include "Symbol.h"
+# include "timing.h"
+# include "storage.h"
 
 using std::string;
 
@@ -20,6 +22,25 @@ using std::string;
 Symbol::Symbol(const string &name, const Type &type)
     : _name(name), _type(type), _offset(0)
 {
+    count(SYMBOLS);
+}
+
+
+/*
+ * Functions:	Symbol::operator new, Symbol::operator delete
+ *
+ * Description:	Allocate and free a symbol in the storage of the current
+ *		compilation.
+ */
+
+void *Symbol::operator new(size_t size)
+{
+    return obtain(size, destroy<Symbol>);
+}
+
+void Symbol::operator delete(void *symbol)
+{
+    discard(symbol);
 }
 
 
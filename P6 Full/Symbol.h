@@ -20,6 +20,8 @@ public:
     int _offset;
 
     Symbol(const string &name, const Type &type);
+    static void *operator new(size_t size);
+    static void operator delete(void *symbol);
     const string &name() const;
     const Type &type() const;
 };
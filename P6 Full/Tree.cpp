@@ -22,11 +22,55 @@
 # include <cstdlib>
 # include <sstream>
 # include "tokens.h"
+# include "timing.h"
+# include "storage.h"
 # include "Tree.h"
 
 using namespace std;
 
 
+/*
+ * Function:	Node::Node (constructor)
+ *
+ * Description:	Initialize a node, counting it for the time report.
+ */
+
+Node::Node()
+{
+    countNode(this);
+}
+
+
+/*
+ * Function:	Node::~Node (destructor)
+ *
+ * Description:	Destroy a node, forgetting it for the time report.
+ */
+
+Node::~Node()
+{
+    forgetNode(this);
+}
+
+
+/*
+ * Functions:	Node::operator new, Node::operator delete
+ *
+ * Description:	Allocate and free a node in the storage of the current
+ *		compilation.
+ */
+
+void *Node::operator new(size_t size)
+{
+    return obtain(size, destroy<Node>);
+}
+
+void Node::operator delete(void *node)
+{
+    discard(node);
+}
+
+
 /*
  * Function:	Expression::Expression (constructor)
  *
@@ -195,6 +239,22 @@ Call::Call(const Symbol *id, const Expressions &args, const Type &type)
 }
 
 
+/*
+ * Function:	Inline::Inline (constructor)
+ *
+ * Description:	Initialize an inlined function call, which consists of
+ *		the assignments of the arguments to the parameters and the
+ *		body of the function.  Like a call, it may change any
+ *		register or memory.
+ */
+
+Inline::Inline(const Symbol *id, const Statements &params, Block *body, const Type &type)
+    : Expression(type), _id(id), _params(params), _body(body)
+{
+    _hasCall = true;
+}
+
+
 /*
  * Function:	Not::Not (constructor)
  *
@@ -463,11 +523,12 @@ Scope *Block::declarations() const
 /*
  * Function:	While::While (constructor)
  *
- * Description:	Initialize a while statement.
+ * Description:	Initialize a while statement, which is profiled by the
+ *		given counter and the one after it.
  */
 
-While::While(Expression *expr, Statement *stmt)
-    : _expr(expr), _stmt(stmt)
+While::While(Expression *expr, Statement *stmt, unsigned counter)
+    : _expr(expr), _stmt(stmt), _counter(counter)
 {
 }
 
@@ -475,11 +536,12 @@ While::While(Expression *expr, Statement *stmt)
 /*
  * Function:	For::For (constructor)
  *
- * Description:	Initialize a for statement.
+ * Description:	Initialize a for statement, which is profiled by the
+ *		given counter and the one after it.
  */
 
-For::For(Statement *init, Expression *expr, Statement *incr, Statement *stmt)
-    : _init(init), _expr(expr), _incr(incr), _stmt(stmt)
+For::For(Statement *init, Expression *expr, Statement *incr, Statement *stmt, unsigned counter)
+    : _init(init), _expr(expr), _incr(incr), _stmt(stmt), _counter(counter)
 {
 }
 
@@ -487,11 +549,12 @@ For::For(Statement *init, Expression *expr, Statement *incr, Statement *stmt)
 /*
  * Function:	If::If (constructor)
  *
- * Description:	Initialize an if-then or if-then-else statement.
+ * Description:	Initialize an if-then or if-then-else statement, which is
+ *		profiled by the given counter and the one after it.
  */
 
-If::If(Expression *expr, Statement *thenStmt, Statement *elseStmt)
-    : _expr(expr), _thenStmt(thenStmt), _elseStmt(elseStmt)
+If::If(Expression *expr, Statement *thenStmt, Statement *elseStmt, unsigned counter)
+    : _expr(expr), _thenStmt(thenStmt), _elseStmt(elseStmt), _counter(counter)
 {
 }
 
@@ -511,12 +574,50 @@ Simple::Simple(Expression *expr)
 /*
  * Function:	Function::Function (constructor)
  *
- * Description:	Initialize a function object.
+ * Description:	Initialize a function object, which is profiled by the
+ *		given counter.
+ */
+
+Function::Function(const Symbol *id, Block *body, unsigned counter)
+    : _id(id), _body(body), _addressed(true), _counter(counter)
+{
+}
+
+
+/*
+ * Function:	Function::id (accessor)
+ *
+ * Description:	Return the symbol of this function.
+ */
+
+const Symbol *Function::id() const
+{
+    return _id;
+}
+
+
+/*
+ * Function:	Expression::isIdentifier (accessor)
+ *
+ * Description:	Return false since most expressions are not identifiers.
+ */
+
+bool Expression::isIdentifier(const Symbol *&symbol) const
+{
+    return false;
+}
+
+
+/*
+ * Function:	Identifier::isIdentifier (accessor)
+ *
+ * Description:	Return true since an identifier is in fact an identifier.
  */
 
-Function::Function(const Symbol *id, Block *body)
-    : _id(id), _body(body)
+bool Identifier::isIdentifier(const Symbol *&symbol) const
 {
+    symbol = _symbol;
+    return true;
 }
 
 
@@ -545,6 +646,32 @@ bool Number::isNumber(unsigned &value) const
 }
 
 
+/*
+ * Function:	Expression::isCall (accessor)
+ *
+ * Description:	Return false since most expressions are not calls.
+ */
+
+bool Expression::isCall(const Symbol *&id, Expressions &args) const
+{
+    return false;
+}
+
+
+/*
+ * Function:	Call::isCall (accessor)
+ *
+ * Description:	Return true since a call is in fact a call.
+ */
+
+bool Call::isCall(const Symbol *&id, Expressions &args) const
+{
+    id = _id;
+    args = _args;
+    return true;
+}
+
+
 /*
  * Function:	Expression::isDereference (accessor)
  *
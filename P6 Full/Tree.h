@@ -20,7 +20,10 @@
  *		Tree.h - class definitions
  *		Tree.cpp - constructors and accessors
  *		allocator.cpp - member functions to do storage allocation
+ *		optimizer.cpp - member functions to simplify the tree
+ *		inliner.cpp - member functions to inline function calls
  *		generator.cpp - member functions to do code generation
+ *		interpreter.cpp - member functions to encode bytecode
  *		writer.cpp - member functions to write the tree to a stream
  */
 
@@ -35,6 +38,8 @@
 
 typedef std::vector<class Statement *> Statements;
 typedef std::vector<class Expression *> Expressions;
+typedef std::vector<const class Symbol *> References;
+typedef std::vector<class Function *> Functions;
 
 
 /* The base class */
@@ -43,13 +48,16 @@ class Node {
 protected:
     typedef std::string string;
     typedef std::ostream ostream;
-    Node() {}
+    Node();
 
 public:
-    virtual ~Node() {}
+    virtual ~Node();
+    static void *operator new(size_t size);
+    static void operator delete(void *node);
     virtual void write(ostream &ostr) const = 0;
     virtual void allocate(int &offset) const {}
     virtual void generate() {}
+    virtual void encode() {}
 };
 
 
@@ -58,6 +66,13 @@ public:
 class Statement : public Node {
 protected:
     Statement() {}
+
+public:
+    virtual Statement *clone() const = 0;
+    virtual Statement *simplify() { return this; }
+    virtual bool returns() const { return false; }
+    virtual void mark() const {}
+    virtual void expand() {}
 };
 
 
@@ -76,10 +91,17 @@ public:
 
     const Type &type() const;
     bool lvalue() const;
-    void test(const Label &label, bool ifTrue);
+    virtual void test(const Label &label, bool ifTrue);
 
     virtual void operand(ostream &ostr) const;
+    virtual bool signature(ostream &ostr, References &refs) const;
+    virtual Expression *clone() const = 0;
+    virtual Expression *fold() { return this; }
+    virtual Expression *expand() { return this; }
+    virtual void mark() const {}
+    virtual bool isCall(const Symbol *&id, Expressions &args) const;
     virtual bool isDereference(Expression *&pointer) const;
+    virtual bool isIdentifier(const Symbol *&symbol) const;
     virtual bool isNumber(unsigned &value) const;
 };
 
@@ -90,6 +112,13 @@ class Binary : public Expression {
 protected:
     Expression *_left, *_right;
     Binary(Expression *left, Expression *right, const Type &type);
+    virtual bool calculate(int left, int right, int &result) const;
+
+public:
+    virtual bool signature(ostream &ostr, References &refs) const;
+    virtual Expression *fold();
+    virtual Expression *expand();
+    virtual void mark() const;
 };
 
 
@@ -99,6 +128,13 @@ class Unary : public Expression {
 protected:
     Expression *_expr;
     Unary(Expression *expr, const Type &type);
+    virtual bool calculate(int operand, int &result) const;
+
+public:
+    virtual bool signature(ostream &ostr, References &refs) const;
+    virtual Expression *fold();
+    virtual Expression *expand();
+    virtual void mark() const;
 };
 
 
@@ -111,7 +147,10 @@ public:
     String(const string &value);
     const string &value() const;
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
     virtual void operand(ostream &ostr) const;
+    virtual bool signature(ostream &ostr, References &refs) const;
+    virtual void encode();
 };
 
 
@@ -124,7 +163,12 @@ public:
     Identifier(const Symbol *symbol);
     const Symbol *symbol() const;
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
     virtual void operand(ostream &ostr) const;
+    virtual bool signature(ostream &ostr, References &refs) const;
+    virtual void mark() const;
+    virtual bool isIdentifier(const Symbol *&symbol) const;
+    virtual void encode();
 };
 
 
@@ -138,8 +182,11 @@ public:
     Number(const string &value);
     const string &value() const;
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
     virtual void operand(ostream &ostr) const;
+    virtual bool signature(ostream &ostr, References &refs) const;
     virtual bool isNumber(unsigned &value) const;
+    virtual void encode();
 };
 
 
@@ -152,7 +199,29 @@ class Call : public Expression {
 public:
     Call(const Symbol *id, const Expressions &args, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual Expression *fold();
+    virtual Expression *expand();
+    virtual void mark() const;
+    virtual bool isCall(const Symbol *&id, Expressions &args) const;
+    virtual void generate();
+    virtual void encode();
+};
+
+
+/* An inlined function call: the body of id evaluated in place */
+
+class Inline : public Expression {
+    const Symbol *_id;
+    Statements _params;
+    class Block *_body;
+
+public:
+    Inline(const Symbol *id, const Statements &params, Block *body, const Type &type);
+    virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -162,7 +231,11 @@ class Not : public Unary {
 public:
     Not(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int operand, int &result) const;
     virtual void generate();
+    virtual void test(const Label &label, bool ifTrue);
+    virtual void encode();
 };
 
 
@@ -172,7 +245,10 @@ class Negate : public Unary {
 public:
     Negate(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int operand, int &result) const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -182,8 +258,11 @@ class Dereference : public Unary {
 public:
     Dereference(Expression *expr, const Type &type);
     virtual bool isDereference(Expression *&pointer) const;
+    virtual bool signature(ostream &ostr, References &refs) const;
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -193,7 +272,10 @@ class Address : public Unary {
 public:
     Address(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual void mark() const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -203,7 +285,9 @@ class Cast : public Unary {
 public:
     Cast(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -213,7 +297,10 @@ class Multiply : public Binary {
 public:
     Multiply(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int left, int right, int &result) const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -223,7 +310,10 @@ class Divide : public Binary {
 public:
     Divide(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int left, int right, int &result) const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -233,7 +323,10 @@ class Remainder : public Binary {
 public:
     Remainder(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int left, int right, int &result) const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -243,7 +336,10 @@ class Add : public Binary {
 public:
     Add(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int left, int right, int &result) const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -253,7 +349,10 @@ class Subtract : public Binary {
 public:
     Subtract(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int left, int right, int &result) const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -263,7 +362,11 @@ class LessThan : public Binary {
 public:
     LessThan(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int left, int right, int &result) const;
     virtual void generate();
+    virtual void test(const Label &label, bool ifTrue);
+    virtual void encode();
 };
 
 
@@ -273,7 +376,11 @@ class GreaterThan : public Binary {
 public:
     GreaterThan(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int left, int right, int &result) const;
     virtual void generate();
+    virtual void test(const Label &label, bool ifTrue);
+    virtual void encode();
 };
 
 
@@ -283,7 +390,11 @@ class LessOrEqual : public Binary {
 public:
     LessOrEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int left, int right, int &result) const;
     virtual void generate();
+    virtual void test(const Label &label, bool ifTrue);
+    virtual void encode();
 };
 
 
@@ -293,7 +404,11 @@ class GreaterOrEqual : public Binary {
 public:
     GreaterOrEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int left, int right, int &result) const;
     virtual void generate();
+    virtual void test(const Label &label, bool ifTrue);
+    virtual void encode();
 };
 
 
@@ -303,7 +418,11 @@ class Equal : public Binary {
 public:
     Equal(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int left, int right, int &result) const;
     virtual void generate();
+    virtual void test(const Label &label, bool ifTrue);
+    virtual void encode();
 };
 
 
@@ -313,7 +432,11 @@ class NotEqual : public Binary {
 public:
     NotEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual bool calculate(int left, int right, int &result) const;
     virtual void generate();
+    virtual void test(const Label &label, bool ifTrue);
+    virtual void encode();
 };
 
 
@@ -323,7 +446,12 @@ class LogicalAnd: public Binary {
 public:
     LogicalAnd(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual Expression *fold();
+    virtual bool signature(ostream &ostr, References &refs) const;
     virtual void generate();
+    virtual void test(const Label &label, bool ifTrue);
+    virtual void encode();
 };
 
 
@@ -333,7 +461,12 @@ class LogicalOr : public Binary {
 public:
     LogicalOr(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual Expression *clone() const;
+    virtual Expression *fold();
+    virtual bool signature(ostream &ostr, References &refs) const;
     virtual void generate();
+    virtual void test(const Label &label, bool ifTrue);
+    virtual void encode();
 };
 
 
@@ -345,7 +478,12 @@ class Assignment : public Statement {
 public:
     Assignment(Expression *left, Expression *right);
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
+    virtual Statement *simplify();
+    virtual void mark() const;
+    virtual void expand();
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -357,7 +495,13 @@ class Return : public Statement {
 public:
     Return(Expression *expr);
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
+    virtual Statement *simplify();
+    virtual bool returns() const;
+    virtual void mark() const;
+    virtual void expand();
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -371,8 +515,14 @@ public:
     Block(Scope *decls, const Statements &stmts);
     Scope *declarations() const;
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
+    virtual Statement *simplify();
+    virtual bool returns() const;
+    virtual void mark() const;
+    virtual void expand();
     virtual void allocate(int &offset) const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -381,12 +531,18 @@ public:
 class While : public Statement {
     Expression *_expr;
     Statement *_stmt;
+    unsigned _counter;
 
 public:
-    While(Expression *expr, Statement *stmt);
+    While(Expression *expr, Statement *stmt, unsigned counter);
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
+    virtual Statement *simplify();
+    virtual void mark() const;
+    virtual void expand();
     virtual void allocate(int &offset) const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -397,12 +553,18 @@ class For : public Statement {
     Expression *_expr;
     Statement *_incr;
     Statement *_stmt;
+    unsigned _counter;
 
 public:
-    For(Statement *init, Expression *expr, Statement *incr, Statement *stmt);
+    For(Statement *init, Expression *expr, Statement *incr, Statement *stmt, unsigned counter);
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
+    virtual Statement *simplify();
+    virtual void mark() const;
+    virtual void expand();
     virtual void allocate(int &offset) const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -411,12 +573,19 @@ public:
 class If : public Statement {
     Expression *_expr;
     Statement *_thenStmt, *_elseStmt;
+    unsigned _counter;
 
 public:
-    If(Expression *expr, Statement *thenStmt, Statement *elseStmt);
+    If(Expression *expr, Statement *thenStmt, Statement *elseStmt, unsigned counter);
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
+    virtual Statement *simplify();
+    virtual bool returns() const;
+    virtual void mark() const;
+    virtual void expand();
     virtual void allocate(int &offset) const;
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -428,7 +597,12 @@ class Simple : public Statement {
 public:
     Simple(Expression *expr);
     virtual void write(ostream &ostr) const;
+    virtual Statement *clone() const;
+    virtual Statement *simplify();
+    virtual void mark() const;
+    virtual void expand();
     virtual void generate();
+    virtual void encode();
 };
 
 
@@ -437,12 +611,20 @@ public:
 class Function : public Node {
     const Symbol *_id;
     Block *_body;
+    bool _addressed;
+    unsigned _counter;
 
 public:
-    Function(const Symbol *id, Block *body);
+    Function(const Symbol *id, Block *body, unsigned counter);
+    const Symbol *id() const;
     virtual void write(ostream &ostr) const;
+    void simplify();
+    bool inlineable() const;
+    Expression *instantiate(const Expressions &args, const Type &type) const;
+    void expand();
     virtual void allocate(int &offset) const;
     virtual void generate();
+    virtual void encode();
 };
 
 # endif /* TREE_H */
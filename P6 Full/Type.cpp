@@ -22,6 +22,7 @@
 # include <cassert>
 # include "tokens.h"
 # include "Type.h"
+# include "storage.h"
 
 using namespace std;
 
@@ -78,6 +79,24 @@ Type::Type(int specifier, unsigned indirection, Parameters *parameters)
 }
 
 
+/*
+ * Functions:	Parameters::operator new, Parameters::operator delete
+ *
+ * Description:	Allocate and free a parameter list in the storage of the current
+ *		compilation.
+ */
+
+void *Parameters::operator new(size_t size)
+{
+    return obtain(size, destroy<Parameters>);
+}
+
+void Parameters::operator delete(void *params)
+{
+    discard(params);
+}
+
+
 /*
  * Function:	Type::operator ==
  *
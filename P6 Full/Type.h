@@ -27,7 +27,7 @@
 # include <vector>
 # include <ostream>
 
-typedef std::vector<class Type> Parameters;
+class Parameters;
 
 class Type {
     int _specifier;
@@ -67,6 +67,12 @@ public:
     unsigned size() const;
 };
 
+class Parameters : public std::vector<Type> {
+public:
+    static void *operator new(size_t size);
+    static void operator delete(void *params);
+};
+
 std::ostream &operator <<(std::ostream &ostr, const Type &type);
 
 # endif /* TYPE_H */
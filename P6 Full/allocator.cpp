@@ -15,6 +15,7 @@
 # include "checker.h"
 # include "machine.h"
 # include "tokens.h"
+# include "timing.h"
 # include "Tree.h"
 
 using namespace std;
@@ -136,20 +137,30 @@ void If::allocate(int &offset) const
  * Function:	Function::allocate
  *
  * Description:	Allocate storage for this function and return the number of
- *		bytes required.  The parameters are allocated offsets as
- *		well, starting with the given offset.
+ *		bytes required.  The parameters passed on the stack are
+ *		allocated offsets as well, starting with the given offset.
+ *		Those passed in registers are stored in the frame along
+ *		with the local variables.
  */
 
 void Function::allocate(int &offset) const
 {
     Parameters *params = _id->type().parameters();
     const Symbols &symbols = _body->declarations()->symbols();
+    PhaseTimer timer(ALLOCATING);
+    int stack = offset;
 
-    for (unsigned i = 0; i < params->size(); i ++) {
-	symbols[i]->_offset = offset;
-	offset += (*params)[i].promote().size();
-    }
 
     offset = 0;
+
+    for (unsigned i = 0; i < params->size(); i ++)
+	if (i < NUM_ARG_REGS) {
+	    offset -= (*params)[i].promote().size();
+	    symbols[i]->_offset = offset;
+	} else {
+	    symbols[i]->_offset = stack;
+	    stack += SIZEOF_ARG;
+	}
+
     _body->allocate(offset);
 }
@@ -0,0 +1,1189 @@
+/*
+ * File:	assembler.cpp
+ *
+ * Description:	This file contains the public and private function
+ *		definitions for assembling the code generated into an ELF32
+ *		relocatable object file for the i386, so that no separate
+ *		assembler need be run.
+ *
+ *		We accept only what the generator writes: labels, the
+ *		directives .set, .globl, .comm, .text, .data, .section
+ *		.rodata, .ascii, and .asciz,
+ *		and the instructions below, with register, immediate, and
+ *		memory operands of the form disp(%reg) or disp, where a
+ *		displacement may be a number plus a symbol.
+ *
+ *		mov, movb, movsbl, movzbl, lea, add, sub, cmp, imul, idiv,
+ *		neg, not, sar, shl, shr, setcc, jcc, jmp, call, push, pop,
+ *		cltd, leave, ret
+ *
+ *		The instructions are encoded as the GNU assembler would, so
+ *		the object files are the same apart from the order of the
+ *		symbols.  In particular, an operand involving a symbol is
+ *		always given 32 bits, even if the symbol is a constant, since
+ *		it is defined by .set only after the function.  A jump to a
+ *		label is first assumed to be short and is made long only if
+ *		the label is too far away, which is repeated until no jump
+ *		changes.  A reference to a local symbol is made relative to
+ *		its section, and a call or jump to a local label is resolved
+ *		here.
+ *
+ *		The same code may instead be linked into an image to be
+ *		loaded into memory and run at once, in which case the data,
+ *		read-only data, and common symbols follow the text, and the undefined
+ *		symbols are resolved by the caller.
+ *
+ *		The state is local to each thread, since several files may
+ *		be compiled at once.  The object file is written in the
+ *		byte order of the host, which must also be little endian.
+ */
+
+# include <map>
+# include <vector>
+# include <cctype>
+# include <cstdlib>
+# include <cstring>
+# include <iostream>
+# include <elf.h>
+# include "assembler.h"
+# include "timing.h"
+
+using namespace std;
+
+enum { TEXT, DATA, RODATA, BSS, UNDEFINED, ABSOLUTE, COMMON };
+
+static const int JMP = -1, NO_JUMP = -2;
+
+struct ObjectSymbol {
+    int section = UNDEFINED;
+    long value = 0;
+    unsigned size = 0;
+    bool global = false;
+    unsigned index = 0;
+};
+
+struct Operand {
+    enum { REGISTER, IMMEDIATE, MEMORY } kind;
+    int reg = -1;
+    bool byte = false;
+    long value = 0;
+    string symbol;
+    bool wide = false;
+};
+
+struct Relocation {
+    unsigned offset;
+    string symbol;
+    bool relative;
+};
+
+struct Piece {
+    string code, label, target;
+    vector<Relocation> relocs;
+    int jump = NO_JUMP;
+    bool wide = false;
+    unsigned offset = 0;
+};
+
+static const char *registers[] = {
+    "%eax", "%ecx", "%edx", "%ebx", "%esp", "%ebp", "%esi", "%edi"
+};
+
+static const char *bytes[] = {"%al", "%cl", "%dl", "%bl"};
+
+static const map<string, int> conditions = {
+    {"o", 0x0}, {"no", 0x1}, {"b", 0x2}, {"ae", 0x3}, {"e", 0x4},
+    {"z", 0x4}, {"ne", 0x5}, {"nz", 0x5}, {"be", 0x6}, {"a", 0x7},
+    {"s", 0x8}, {"ns", 0x9}, {"l", 0xc}, {"ge", 0xd}, {"le", 0xe},
+    {"g", 0xf},
+};
+
+static const map<string, int> arithmetic = {
+    {"addl", 0}, {"orl", 1}, {"andl", 4}, {"subl", 5}, {"xorl", 6},
+    {"cmpl", 7}, {"cmp", 7},
+};
+
+static const map<string, int> shifts = {{"shll", 4}, {"shrl", 5}, {"sarl", 7}};
+
+static const map<string, int> unary = {{"notl", 2}, {"negl", 3}, {"idivl", 7}};
+
+static thread_local map<string, ObjectSymbol> symbols;
+static thread_local vector<string> mentioned;
+static thread_local map<string, long> constants;
+static thread_local vector<Piece> pieces;
+static thread_local string data, rodata;
+static thread_local int section;
+
+
+/*
+ * Function:	symbol (private)
+ *
+ * Description:	Return the symbol with the given name, creating it if it
+ *		has not yet been mentioned.  The symbols are written in the
+ *		order in which they are first mentioned.
+ */
+
+static ObjectSymbol &symbol(const string &name)
+{
+    if (symbols.count(name) == 0)
+	mentioned.push_back(name);
+
+    return symbols[name];
+}
+
+
+/*
+ * Function:	put (private)
+ *
+ * Description:	Append a value of the given number of bytes to some code,
+ *		least significant byte first.
+ */
+
+static void put(string &code, long value, unsigned size)
+{
+    for (unsigned i = 0; i < size; i ++)
+	code += (char) (value >> 8 * i);
+}
+
+
+/*
+ * Function:	patch (private)
+ *
+ * Description:	Add a value to the 32-bit value at the given offset.
+ */
+
+static void patch(string &code, unsigned offset, long value)
+{
+    unsigned char *p = (unsigned char *) &code[offset];
+    long old = (int) (p[0] | p[1] << 8 | p[2] << 16 | (unsigned) p[3] << 24);
+
+    for (unsigned i = 0; i < 4; i ++)
+	p[i] = (old + value) >> 8 * i;
+}
+
+
+/*
+ * Function:	fits (private)
+ *
+ * Description:	Return whether a value fits in a signed byte.
+ */
+
+static bool fits(long value)
+{
+    return value >= -128 && value <= 127;
+}
+
+
+/*
+ * Function:	expression (private)
+ *
+ * Description:	Parse an expression consisting of numbers and at most one
+ *		symbol added together, returning whether it was valid.  A
+ *		symbol defined by .set is replaced by its value.  Values are
+ *		taken modulo 2^32, since an unsigned number may be written.
+ */
+
+static bool expression(const string &text, Operand &operand)
+{
+    size_t i = 0, start;
+    int sign = 1;
+
+
+    if (text.empty())
+	return false;
+
+    while (i < text.size()) {
+	if (text[i] == '+' || text[i] == '-') {
+	    sign = text[i ++] == '-' ? -1 : 1;
+	    continue;
+	}
+
+	start = i;
+
+	if (isdigit(text[i])) {
+	    operand.value += sign * strtol(text.c_str() + i, nullptr, 10);
+
+	    while (i < text.size() && isdigit(text[i]))
+		i ++;
+
+	} else if (isalpha(text[i]) || text[i] == '_' || text[i] == '.') {
+	    while (i < text.size() && (isalnum(text[i]) || text[i] == '_' || text[i] == '.'))
+		i ++;
+
+	    if (sign < 0 || !operand.symbol.empty())
+		return false;
+
+	    operand.symbol = text.substr(start, i - start);
+	    operand.wide = true;
+	    symbol(operand.symbol);
+
+	    if (constants.count(operand.symbol) > 0) {
+		operand.value += constants[operand.symbol];
+		operand.symbol.clear();
+	    }
+
+	} else
+	    return false;
+
+	sign = 1;
+    }
+
+    operand.value = (int) operand.value;
+    return true;
+}
+
+
+/*
+ * Function:	operand (private)
+ *
+ * Description:	Parse an operand, returning whether it was valid.
+ */
+
+static bool operand(const string &text, Operand &result)
+{
+    size_t paren;
+
+
+    if (text[0] == '%') {
+	result.kind = Operand::REGISTER;
+
+	for (int i = 0; i < 8; i ++)
+	    if (text == registers[i])
+		result.reg = i;
+
+	for (int i = 0; i < 4; i ++)
+	    if (text == bytes[i]) {
+		result.reg = i;
+		result.byte = true;
+	    }
+
+	return result.reg >= 0;
+    }
+
+    if (text[0] == '$') {
+	result.kind = Operand::IMMEDIATE;
+	return expression(text.substr(1), result);
+    }
+
+    result.kind = Operand::MEMORY;
+    paren = text.find('(');
+
+    if (paren == string::npos)
+	return expression(text, result);
+
+    if (text.back() != ')')
+	return false;
+
+    for (int i = 0; i < 8; i ++)
+	if (text.compare(paren + 1, text.size() - paren - 2, registers[i]) == 0)
+	    result.reg = i;
+
+    return result.reg >= 0 && (paren == 0 || expression(text.substr(0, paren), result));
+}
+
+
+/*
+ * Function:	immediate (private)
+ *
+ * Description:	Append an immediate value of the given number of bytes,
+ *		noting a relocation if it involves a symbol.
+ */
+
+static void immediate(Piece &piece, const Operand &imm, unsigned size)
+{
+    if (!imm.symbol.empty())
+	piece.relocs.push_back({(unsigned) piece.code.size(), imm.symbol, false});
+
+    put(piece.code, imm.value, size);
+}
+
+
+/*
+ * Function:	modrm (private)
+ *
+ * Description:	Append the ModR/M byte, and any SIB byte and displacement,
+ *		for a register or memory operand with the given register or
+ *		opcode extension in the reg field.
+ */
+
+static void modrm(Piece &piece, int reg, const Operand &rm)
+{
+    int mod;
+
+
+    if (rm.kind == Operand::REGISTER) {
+	piece.code += (char) (0xc0 | reg << 3 | rm.reg);
+	return;
+    }
+
+    if (rm.reg < 0) {
+	piece.code += (char) (0x05 | reg << 3);
+	immediate(piece, rm, 4);
+	return;
+    }
+
+    if (rm.wide || !fits(rm.value))
+	mod = 2;
+    else if (rm.value != 0 || rm.reg == 5)
+	mod = 1;
+    else
+	mod = 0;
+
+    piece.code += (char) (mod << 6 | reg << 3 | rm.reg);
+
+    if (rm.reg == 4)
+	piece.code += (char) 0x24;
+
+    if (mod == 1)
+	put(piece.code, rm.value, 1);
+    else if (mod == 2)
+	immediate(piece, rm, 4);
+}
+
+
+/*
+ * Function:	encode (private)
+ *
+ * Description:	Encode an instruction other than a jump, returning whether
+ *		it is one we know.  Operands are in AT&T order, so the
+ *		destination is last.
+ */
+
+static bool encode(const string &op, const vector<Operand> &args, Piece &piece)
+{
+    const Operand *src = args.size() > 0 ? &args[0] : nullptr;
+    const Operand *dst = args.size() > 1 ? &args[1] : nullptr;
+    string &code = piece.code;
+    bool reg, mem, imm, small;
+
+
+    if (args.size() == 0) {
+	if (op == "ret")
+	    code += (char) 0xc3;
+	else if (op == "leave")
+	    code += (char) 0xc9;
+	else if (op == "cltd")
+	    code += (char) 0x99;
+	else
+	    return false;
+
+	return true;
+    }
+
+    reg = src->kind == Operand::REGISTER;
+    mem = src->kind == Operand::MEMORY;
+    imm = src->kind == Operand::IMMEDIATE;
+    small = imm && !src->wide && fits(src->value);
+
+    if (args.size() == 1) {
+	if (op == "pushl") {
+	    if (reg)
+		code += (char) (0x50 + src->reg);
+	    else if (small) {
+		code += (char) 0x6a;
+		put(code, src->value, 1);
+	    } else if (imm) {
+		code += (char) 0x68;
+		immediate(piece, *src, 4);
+	    } else {
+		code += (char) 0xff;
+		modrm(piece, 6, *src);
+	    }
+
+	} else if (op == "popl" && !imm) {
+	    if (reg)
+		code += (char) (0x58 + src->reg);
+	    else {
+		code += (char) 0x8f;
+		modrm(piece, 0, *src);
+	    }
+
+	} else if (op == "call" && mem && src->reg < 0 && src->value == 0 && !src->symbol.empty()) {
+	    code += (char) 0xe8;
+	    piece.relocs.push_back({1, src->symbol, true});
+	    put(code, -4, 4);
+
+	} else if (unary.count(op) > 0 && !imm) {
+	    code += (char) 0xf7;
+	    modrm(piece, unary.at(op), *src);
+
+	} else if (op.compare(0, 3, "set") == 0 && conditions.count(op.substr(3)) > 0 && !imm) {
+	    code += (char) 0x0f;
+	    code += (char) (0x90 + conditions.at(op.substr(3)));
+	    modrm(piece, 0, *src);
+
+	} else
+	    return false;
+
+	return true;
+    }
+
+    if (args.size() == 3 && op == "imull" && small && args[2].kind == Operand::REGISTER) {
+	code += (char) 0x6b;
+	modrm(piece, args[2].reg, args[1]);
+	put(code, src->value, 1);
+	return true;
+    }
+
+    if (args.size() != 2 || dst->kind == Operand::IMMEDIATE || (mem && dst->kind == Operand::MEMORY))
+	return false;
+
+    if (arithmetic.count(op) > 0) {
+	int n = arithmetic.at(op);
+
+	if (small) {
+	    code += (char) 0x83;
+	    modrm(piece, n, *dst);
+	    put(code, src->value, 1);
+	} else if (imm && dst->kind == Operand::REGISTER && dst->reg == 0) {
+	    code += (char) (n << 3 | 0x05);
+	    immediate(piece, *src, 4);
+	} else if (imm) {
+	    code += (char) 0x81;
+	    modrm(piece, n, *dst);
+	    immediate(piece, *src, 4);
+	} else if (reg) {
+	    code += (char) (n << 3 | 0x01);
+	    modrm(piece, src->reg, *dst);
+	} else {
+	    code += (char) (n << 3 | 0x03);
+	    modrm(piece, dst->reg, *src);
+	}
+
+    } else if (op == "movl") {
+	if (imm && dst->kind == Operand::REGISTER) {
+	    code += (char) (0xb8 + dst->reg);
+	    immediate(piece, *src, 4);
+	} else if (imm) {
+	    code += (char) 0xc7;
+	    modrm(piece, 0, *dst);
+	    immediate(piece, *src, 4);
+	} else if (reg && src->reg == 0 && dst->kind == Operand::MEMORY && dst->reg < 0) {
+	    code += (char) 0xa3;
+	    immediate(piece, *dst, 4);
+	} else if (mem && src->reg < 0 && dst->reg == 0) {
+	    code += (char) 0xa1;
+	    immediate(piece, *src, 4);
+	} else if (reg) {
+	    code += (char) 0x89;
+	    modrm(piece, src->reg, *dst);
+	} else {
+	    code += (char) 0x8b;
+	    modrm(piece, dst->reg, *src);
+	}
+
+    } else if (op == "movb") {
+	if (imm && dst->kind == Operand::REGISTER) {
+	    code += (char) (0xb0 + dst->reg);
+	    put(code, src->value, 1);
+	} else if (imm) {
+	    code += (char) 0xc6;
+	    modrm(piece, 0, *dst);
+	    put(code, src->value, 1);
+	} else if (reg && src->reg == 0 && dst->kind == Operand::MEMORY && dst->reg < 0) {
+	    code += (char) 0xa2;
+	    immediate(piece, *dst, 4);
+	} else if (mem && src->reg < 0 && dst->reg == 0) {
+	    code += (char) 0xa0;
+	    immediate(piece, *src, 4);
+	} else if (reg) {
+	    code += (char) 0x88;
+	    modrm(piece, src->reg, *dst);
+	} else {
+	    code += (char) 0x8a;
+	    modrm(piece, dst->reg, *src);
+	}
+
+    } else if ((op == "movsbl" || op == "movzbl") && !imm && dst->kind == Operand::REGISTER) {
+	code += (char) 0x0f;
+	code += (char) (op == "movsbl" ? 0xbe : 0xb6);
+	modrm(piece, dst->reg, *src);
+
+    } else if (op == "leal" && mem && dst->kind == Operand::REGISTER) {
+	code += (char) 0x8d;
+	modrm(piece, dst->reg, *src);
+
+    } else if (op == "imull" && dst->kind == Operand::REGISTER) {
+	if (small) {
+	    code += (char) 0x6b;
+	    modrm(piece, dst->reg, *dst);
+	    put(code, src->value, 1);
+	} else if (imm) {
+	    code += (char) 0x69;
+	    modrm(piece, dst->reg, *dst);
+	    immediate(piece, *src, 4);
+	} else {
+	    code += (char) 0x0f;
+	    code += (char) 0xaf;
+	    modrm(piece, dst->reg, *src);
+	}
+
+    } else if (shifts.count(op) > 0 && (small || (reg && src->reg == 1 && src->byte))) {
+	if (reg)
+	    code += (char) 0xd3;
+	else
+	    code += (char) (src->value == 1 ? 0xd1 : 0xc1);
+
+	modrm(piece, shifts.at(op), *dst);
+
+	if (imm && src->value != 1)
+	    put(code, src->value, 1);
+
+    } else
+	return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	split (private)
+ *
+ * Description:	Split the operands of an instruction at each comma.
+ */
+
+static vector<string> split(const string &text)
+{
+    vector<string> result;
+    size_t start = 0, comma;
+
+
+    if (text.empty())
+	return result;
+
+    do {
+	comma = text.find(',', start);
+	result.push_back(text.substr(start, comma - start));
+
+	while (!result.back().empty() && isspace(result.back().back()))
+	    result.back().pop_back();
+
+	while (!result.back().empty() && isspace(result.back()[0]))
+	    result.back().erase(0, 1);
+
+	start = comma + 1;
+    } while (comma != string::npos);
+
+    return result;
+}
+
+
+/*
+ * Function:	unescape (private)
+ *
+ * Description:	Return the bytes of a quoted string, with its escape
+ *		sequences replaced as the GNU assembler does.
+ */
+
+static string unescape(const string &text)
+{
+    string result;
+    size_t i = 0;
+    int value, digits;
+
+
+    while (i < text.size()) {
+	if (text[i] != '\\' || i + 1 == text.size()) {
+	    result += text[i ++];
+	    continue;
+	}
+
+	i ++;
+
+	if (text[i] >= '0' && text[i] <= '7') {
+	    for (value = digits = 0; digits < 3 && text[i] >= '0' && text[i] <= '7'; digits ++)
+		value = value * 8 + text[i ++] - '0';
+
+	    result += (char) value;
+
+	} else if (text[i] == 'x' && i + 1 < text.size() && isxdigit(text[i + 1])) {
+	    for (value = 0, i ++; i < text.size() && isxdigit(text[i]); i ++)
+		value = value * 16 + (isdigit(text[i]) ? text[i] - '0' : tolower(text[i]) - 'a' + 10);
+
+	    result += (char) value;
+
+	} else {
+	    switch (text[i]) {
+	    case 'b': result += '\b'; break;
+	    case 'f': result += '\f'; break;
+	    case 'n': result += '\n'; break;
+	    case 'r': result += '\r'; break;
+	    case 't': result += '\t'; break;
+	    default: result += text[i]; break;
+	    }
+
+	    i ++;
+	}
+    }
+
+    return result;
+}
+
+
+/*
+ * Function:	define (private)
+ *
+ * Description:	Define a label at the current position.
+ */
+
+static bool define(const string &name)
+{
+    ObjectSymbol &sym = symbol(name);
+
+
+    if (sym.section != UNDEFINED)
+	return false;
+
+    sym.section = section;
+
+    if (section == TEXT) {
+	pieces.push_back(Piece());
+	pieces.back().label = name;
+    } else
+	sym.value = (section == RODATA ? rodata : data).size();
+
+    return true;
+}
+
+
+/*
+ * Function:	parse (private)
+ *
+ * Description:	Assemble a single line, returning whether it was valid.
+ */
+
+static bool parse(const string &text)
+{
+    vector<string> fields;
+    vector<Operand> args;
+    string op, rest, name;
+    size_t start, end, quote;
+
+
+    start = text.find_first_not_of(" \t");
+
+    if (start == string::npos)
+	return true;
+
+    end = text.find_last_not_of(" \t");
+
+    if (text[end] == ':')
+	return define(text.substr(start, end - start));
+
+    op = text.substr(start, text.find_first_of(" \t", start) - start);
+    start = text.find_first_not_of(" \t", start + op.size());
+    rest = start == string::npos ? "" : text.substr(start, end + 1 - start);
+
+
+    /* The directives. */
+
+    if (op == ".text" || op == ".data") {
+	section = op == ".text" ? TEXT : DATA;
+	return true;
+    }
+
+    if (op == ".section" && rest == ".rodata") {
+	section = RODATA;
+	return true;
+    }
+
+    if (op == ".asciz" || op == ".ascii") {
+	quote = rest.rfind('"');
+
+	if (rest.size() < 2 || rest[0] != '"' || quote == 0)
+	    return false;
+
+	string value = unescape(rest.substr(1, quote - 1));
+
+	if (op == ".asciz")
+	    value += '\0';
+
+	if (section == TEXT) {
+	    pieces.push_back(Piece());
+	    pieces.back().code = value;
+	} else
+	    (section == RODATA ? rodata : data) += value;
+
+	return true;
+    }
+
+    fields = split(rest);
+
+    if (op == ".set")
+	return fields.size() == 2;
+
+    if (op == ".globl" && fields.size() == 1) {
+	symbol(fields[0]).global = true;
+	return true;
+    }
+
+    if (op == ".comm" && fields.size() == 2) {
+	ObjectSymbol &sym = symbol(fields[0]);
+
+	sym.section = COMMON;
+	sym.global = true;
+	sym.size = strtoul(fields[1].c_str(), nullptr, 10);
+
+	for (sym.value = 1; sym.value * 2 <= (long) sym.size && sym.value < 16; )
+	    sym.value *= 2;
+
+	return true;
+    }
+
+
+    /* The instructions, which must be in the text section. */
+
+    if (section != TEXT || op[0] == '.')
+	return false;
+
+    pieces.push_back(Piece());
+
+    if (op == "jmp" || (op[0] == 'j' && conditions.count(op.substr(1)) > 0)) {
+	if (fields.size() != 1 || (!isalpha(fields[0][0]) && fields[0][0] != '_' && fields[0][0] != '.'))
+	    return false;
+
+	pieces.back().jump = op == "jmp" ? JMP : conditions.at(op.substr(1));
+	pieces.back().target = fields[0];
+	symbol(fields[0]);
+	return true;
+    }
+
+    for (auto &field : fields) {
+	args.push_back(Operand());
+
+	if (field.empty() || !operand(field, args.back()))
+	    return false;
+    }
+
+    return encode(op, args, pieces.back());
+}
+
+
+/*
+ * Function:	layout (private)
+ *
+ * Description:	Lay out the text section, assigning the labels their
+ *		offsets and deciding which jumps must be long, and then
+ *		write the code.  A jump to a symbol not in the text section
+ *		is always long and needs a relocation.
+ */
+
+static void layout(string &text, vector<Relocation> &relocs)
+{
+    unsigned offset;
+    bool changed;
+    long distance;
+
+
+    for (auto &piece : pieces)
+	if (piece.jump != NO_JUMP)
+	    piece.wide = symbols[piece.target].section != TEXT;
+
+    do {
+	offset = 0;
+
+	for (auto &piece : pieces) {
+	    piece.offset = offset;
+
+	    if (!piece.label.empty())
+		symbols[piece.label].value = offset;
+
+	    if (piece.jump == NO_JUMP)
+		offset += piece.code.size();
+	    else
+		offset += !piece.wide ? 2 : piece.jump == JMP ? 5 : 6;
+	}
+
+	changed = false;
+
+	for (auto &piece : pieces)
+	    if (piece.jump != NO_JUMP && !piece.wide) {
+		distance = symbols[piece.target].value - (piece.offset + 2);
+
+		if (!fits(distance))
+		    piece.wide = changed = true;
+	    }
+
+    } while (changed);
+
+    for (auto &piece : pieces) {
+	if (piece.jump == NO_JUMP) {
+	    for (auto reloc : piece.relocs) {
+		reloc.offset += text.size();
+		relocs.push_back(reloc);
+	    }
+
+	    text += piece.code;
+	    continue;
+	}
+
+	if (piece.jump == JMP)
+	    text += (char) (piece.wide ? 0xe9 : 0xeb);
+	else if (piece.wide) {
+	    text += (char) 0x0f;
+	    text += (char) (0x80 + piece.jump);
+	} else
+	    text += (char) (0x70 + piece.jump);
+
+	if (!piece.wide)
+	    put(text, symbols[piece.target].value - (text.size() + 1), 1);
+	else if (symbols[piece.target].section == TEXT)
+	    put(text, symbols[piece.target].value - (text.size() + 4), 4);
+	else {
+	    relocs.push_back({(unsigned) text.size(), piece.target, true});
+	    put(text, -4, 4);
+	}
+    }
+}
+
+
+/*
+ * Function:	resolve (private)
+ *
+ * Description:	Resolve the relocations against local symbols.  A relative
+ *		reference within the text section needs no relocation at
+ *		all, and any other reference is made relative to the section
+ *		of the symbol, since a local symbol is not visible to the
+ *		linker.
+ */
+
+static void resolve(string &text, vector<Relocation> &relocs)
+{
+    static const char *names[] = {".text", ".data", ".rodata"};
+    vector<Relocation> result;
+
+
+    for (auto &reloc : relocs) {
+	ObjectSymbol &sym = symbols[reloc.symbol];
+
+	if (sym.global || (sym.section != TEXT && sym.section != DATA && sym.section != RODATA)) {
+	    result.push_back(reloc);
+	    continue;
+	}
+
+	if (reloc.relative && sym.section == TEXT)
+	    patch(text, reloc.offset, sym.value - reloc.offset);
+	else {
+	    patch(text, reloc.offset, sym.value);
+	    reloc.symbol = names[sym.section];
+	    result.push_back(reloc);
+	}
+    }
+
+    relocs = result;
+}
+
+
+/*
+ * Function:	write (private)
+ *
+ * Description:	Write the object file, with the sections in the order
+ *		.text, .rel.text, .data, .bss, .rodata, .symtab, .strtab, and
+ *		.shstrtab.  The symbol table has the section symbols that
+ *		are needed, then the local symbols other than the labels
+ *		generated, and then the global and undefined symbols.
+ */
+
+static void write(ostream &ostr, const string &text, vector<Relocation> &relocs)
+{
+    enum {NONE, STEXT, SREL, SDATA, SBSS, SRODATA, SSYMTAB, SSTRTAB, SSHSTRTAB, SHNUM};
+    static const char *names[] = {
+	"", ".text", ".rel.text", ".data", ".bss", ".rodata", ".symtab", ".strtab",
+	".shstrtab"
+    };
+    static const int indices[] = {STEXT, SDATA, SRODATA};
+
+    vector<Elf32_Sym> symtab(1);
+    vector<Elf32_Rel> reltab;
+    string strtab(1, '\0'), shstrtab(1, '\0'), contents[SHNUM];
+    Elf32_Shdr headers[SHNUM];
+    Elf32_Ehdr header;
+    unsigned locals, offset;
+
+
+    /* The symbol table. */
+
+    for (int s = TEXT; s <= RODATA; s ++)
+	for (auto &reloc : relocs)
+	    if (reloc.symbol == names[indices[s]]) {
+		symbols[reloc.symbol].index = symtab.size();
+		symtab.push_back(Elf32_Sym());
+		memset(&symtab.back(), 0, sizeof(Elf32_Sym));
+		symtab.back().st_info = ELF32_ST_INFO(STB_LOCAL, STT_SECTION);
+		symtab.back().st_shndx = indices[s];
+		break;
+	    }
+
+    for (int pass = 0; pass < 2; pass ++) {
+	if (pass == 1)
+	    locals = symtab.size();
+
+	for (auto &name : mentioned) {
+	    ObjectSymbol &sym = symbols[name];
+	    bool global = sym.global || sym.section == UNDEFINED;
+
+	    if (global != (pass == 1) || name.compare(0, 2, ".L") == 0)
+		continue;
+
+	    sym.index = symtab.size();
+	    symtab.push_back(Elf32_Sym());
+	    memset(&symtab.back(), 0, sizeof(Elf32_Sym));
+	    symtab.back().st_name = strtab.size();
+	    symtab.back().st_value = sym.value;
+	    symtab.back().st_size = sym.size;
+	    strtab += name + '\0';
+
+	    if (sym.section == COMMON) {
+		symtab.back().st_info = ELF32_ST_INFO(STB_GLOBAL, STT_OBJECT);
+		symtab.back().st_shndx = SHN_COMMON;
+	    } else {
+		symtab.back().st_info = ELF32_ST_INFO(global ? STB_GLOBAL : STB_LOCAL, STT_NOTYPE);
+		symtab.back().st_shndx = sym.section <= RODATA ? indices[sym.section] : sym.section == ABSOLUTE ? SHN_ABS : SHN_UNDEF;
+	    }
+	}
+    }
+
+    for (auto &reloc : relocs) {
+	reltab.push_back(Elf32_Rel());
+	reltab.back().r_offset = reloc.offset;
+	reltab.back().r_info = ELF32_R_INFO(symbols[reloc.symbol].index, reloc.relative ? R_386_PC32 : R_386_32);
+    }
+
+
+    /* The contents and headers of the sections. */
+
+    contents[STEXT] = text;
+    contents[SREL].assign((const char *) reltab.data(), reltab.size() * sizeof(Elf32_Rel));
+    contents[SDATA] = data;
+    contents[SRODATA] = rodata;
+    contents[SSYMTAB].assign((const char *) symtab.data(), symtab.size() * sizeof(Elf32_Sym));
+    contents[SSTRTAB] = strtab;
+
+    for (unsigned i = 0; i < SHNUM; i ++) {
+	memset(&headers[i], 0, sizeof(Elf32_Shdr));
+	headers[i].sh_name = i > 0 ? shstrtab.size() : 0;
+
+	if (i > 0)
+	    shstrtab += string(names[i]) + '\0';
+    }
+
+    contents[SSHSTRTAB] = shstrtab;
+
+    headers[STEXT].sh_type = SHT_PROGBITS;
+    headers[STEXT].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+    headers[SREL].sh_type = SHT_REL;
+    headers[SREL].sh_flags = SHF_INFO_LINK;
+    headers[SREL].sh_link = SSYMTAB;
+    headers[SREL].sh_info = STEXT;
+    headers[SREL].sh_entsize = sizeof(Elf32_Rel);
+    headers[SREL].sh_addralign = 4;
+    headers[SDATA].sh_type = SHT_PROGBITS;
+    headers[SDATA].sh_flags = SHF_ALLOC | SHF_WRITE;
+    headers[SBSS].sh_type = SHT_NOBITS;
+    headers[SBSS].sh_flags = SHF_ALLOC | SHF_WRITE;
+    headers[SRODATA].sh_type = SHT_PROGBITS;
+    headers[SRODATA].sh_flags = SHF_ALLOC;
+    headers[SSYMTAB].sh_type = SHT_SYMTAB;
+    headers[SSYMTAB].sh_link = SSTRTAB;
+    headers[SSYMTAB].sh_info = locals;
+    headers[SSYMTAB].sh_entsize = sizeof(Elf32_Sym);
+    headers[SSYMTAB].sh_addralign = 4;
+    headers[SSTRTAB].sh_type = SHT_STRTAB;
+    headers[SSHSTRTAB].sh_type = SHT_STRTAB;
+
+    offset = sizeof(Elf32_Ehdr);
+
+    for (unsigned i = 1; i < SHNUM; i ++) {
+	if (headers[i].sh_addralign == 0)
+	    headers[i].sh_addralign = 1;
+
+	offset += -offset % headers[i].sh_addralign;
+	headers[i].sh_offset = offset;
+	headers[i].sh_size = contents[i].size();
+	offset += contents[i].size();
+    }
+
+    offset += -offset % 4;
+
+
+    /* The file header and then everything else. */
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS32;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_type = ET_REL;
+    header.e_machine = EM_386;
+    header.e_version = EV_CURRENT;
+    header.e_shoff = offset;
+    header.e_ehsize = sizeof(Elf32_Ehdr);
+    header.e_shentsize = sizeof(Elf32_Shdr);
+    header.e_shnum = SHNUM;
+    header.e_shstrndx = SSHSTRTAB;
+
+    ostr.write((const char *) &header, sizeof(header));
+    offset = sizeof(header);
+
+    for (unsigned i = 1; i < SHNUM; i ++) {
+	ostr << string(headers[i].sh_offset - offset, '\0') << contents[i];
+	offset = headers[i].sh_offset + contents[i].size();
+    }
+
+    ostr << string(header.e_shoff - offset, '\0');
+    ostr.write((const char *) headers, sizeof(headers));
+}
+
+
+/*
+ * Function:	prepare (private)
+ *
+ * Description:	Assemble the code generated for a translation unit into
+ *		the text section and its relocations, returning whether the
+ *		code could be assembled.  The constants defined by .set are
+ *		found first, since they are used before they are defined.
+ */
+
+static bool prepare(const string &text, string &code, vector<Relocation> &relocs)
+{
+    vector<string> fields;
+    string line;
+    size_t start = 0, end;
+
+
+    symbols.clear();
+    mentioned.clear();
+    constants.clear();
+    pieces.clear();
+    data.clear();
+    rodata.clear();
+    section = TEXT;
+
+    for (start = text.find("\t.set\t"); start != string::npos; start = text.find("\t.set\t", start + 1)) {
+	end = text.find('\n', start);
+	fields = split(text.substr(start + 6, end - start - 6));
+
+	if (fields.size() == 2) {
+	    constants[fields[0]] = strtol(fields[1].c_str(), nullptr, 10);
+	    symbol(fields[0]).section = ABSOLUTE;
+	    symbols[fields[0]].value = constants[fields[0]];
+	}
+    }
+
+    for (start = 0; start < text.size(); start = end + 1) {
+	if ((end = text.find('\n', start)) == string::npos)
+	    end = text.size();
+
+	line = text.substr(start, end - start);
+
+	if (!parse(line)) {
+	    cerr << "scc: cannot assemble '" << line << "'" << endl;
+	    return false;
+	}
+    }
+
+    layout(code, relocs);
+    return true;
+}
+
+
+/*
+ * Function:	assemble
+ *
+ * Description:	Assemble the code generated for a translation unit and
+ *		write the object file, returning whether the code could be
+ *		assembled.
+ */
+
+bool assemble(const string &text, ostream &ostr)
+{
+    PhaseTimer timer(ASSEMBLING);
+    vector<Relocation> relocs;
+    string code;
+
+
+    if (!prepare(text, code, relocs))
+	return false;
+
+    resolve(code, relocs);
+    write(ostr, code, relocs);
+    return true;
+}
+
+
+/*
+ * Function:	link
+ *
+ * Description:	Assemble the code generated for a translation unit into an
+ *		image to be loaded at the given address, returning whether
+ *		the code could be assembled and linked.  The text is
+ *		followed by the data, the read-only data, and then the
+ *		common symbols.  The
+ *		address of each undefined symbol is given by the resolver,
+ *		and the addresses of the global symbols defined are
+ *		returned.
+ */
+
+bool link(const string &text, unsigned long address, const Resolver &resolver,
+	string &image, map<string, unsigned long> &globals)
+{
+    PhaseTimer timer(ASSEMBLING);
+    vector<Relocation> relocs;
+    unsigned long start, readonly, target;
+
+
+    if (!prepare(text, image, relocs))
+	return false;
+
+    image += string(-image.size() % 16, '\0');
+    start = image.size();
+    image += data;
+    readonly = image.size();
+    image += rodata;
+
+    for (auto &name : mentioned) {
+	ObjectSymbol &sym = symbols[name];
+
+	if (sym.section == DATA)
+	    sym.value += start;
+	else if (sym.section == RODATA)
+	    sym.value += readonly;
+	else if (sym.section == COMMON) {
+	    image += string(-image.size() % sym.value, '\0');
+	    sym.section = BSS;
+	    sym.value = image.size();
+	    image += string(sym.size, '\0');
+	}
+    }
+
+    for (auto &name : mentioned) {
+	ObjectSymbol &sym = symbols[name];
+
+	if (sym.section == UNDEFINED) {
+	    if ((sym.value = resolver(name)) == 0) {
+		cerr << "scc: undefined symbol '" << name << "'" << endl;
+		return false;
+	    }
+
+	    sym.section = ABSOLUTE;
+
+	} else if (sym.section != ABSOLUTE) {
+	    sym.value += address;
+	    sym.section = ABSOLUTE;
+	}
+
+	if (sym.global)
+	    globals[name] = sym.value;
+    }
+
+    for (auto &reloc : relocs) {
+	target = symbols[reloc.symbol].value;
+
+	if (reloc.relative)
+	    target -= address + reloc.offset;
+
+	patch(image, reloc.offset, target);
+    }
+
+    return true;
+}
@@ -0,0 +1,24 @@
+/*
+ * File:	assembler.h
+ *
+ * Description:	This file contains the function declarations for
+ *		assembling the code generated into an object file or an
+ *		image to be loaded into memory.
+ */
+
+# ifndef ASSEMBLER_H
+# define ASSEMBLER_H
+# include <map>
+# include <string>
+# include <ostream>
+# include <functional>
+
+typedef std::function<unsigned long (const std::string &name)> Resolver;
+
+bool assemble(const std::string &text, std::ostream &ostr);
+
+bool link(const std::string &text, unsigned long address,
+	const Resolver &resolver, std::string &image,
+	std::map<std::string, unsigned long> &globals);
+
+# endif /* ASSEMBLER_H */
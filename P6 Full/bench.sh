@@ -0,0 +1,123 @@
+#!/bin/sh
+#
+# bench.sh - measure how the compiler scales on synthetic programs
+#
+# Each case is a program written by synth, starting from a base size and
+# scaling one dimension at a time.  Each program is compiled several
+# times with -ftime-report, keeping the fastest run, and a table is
+# printed with the time of each phase, the throughput, and the peak
+# memory, along with the change in total time and memory from the times
+# recorded in the baseline, noting any case more than 25% slower.  With
+# -u, the baseline is written instead.
+#
+# usage: bench.sh [-u] [scc options ...]
+#
+
+SCC=./scc
+SYNTH=./synth
+BASELINE=bench.baseline
+RUNS=${RUNS:-3}
+BASE="-s 1 -f 50 -n 20 -d 4 -g 20 -l 20 -k 3"
+WORKDIR=${TMPDIR:-/tmp}/scc-bench.$$
+
+update=no
+
+if [ "$1" = "-u" ]; then
+    update=yes
+    shift
+fi
+
+OPTIONS=${*:--O}
+
+trap 'rm -rf $WORKDIR' 0
+trap 'exit 1' 1 2 15
+mkdir -p $WORKDIR || exit 1
+
+cases="
+base
+functions-x2	-f 100
+functions-x4	-f 200
+statements-x2	-n 40
+statements-x4	-n 80
+depth-x2	-d 8
+depth-x4	-d 16
+globals-x10	-g 200
+globals-x100	-g 2000
+strings-x10	-l 200
+strings-x100	-l 2000
+nesting-x2	-k 6
+nesting-x4	-k 12
+"
+
+
+# Run a case, printing its name, its lines, the phase times in
+# milliseconds, the total time, and the peak memory in kilobytes.
+
+measure() {
+    name=$1
+    shift
+
+    $SYNTH $BASE "$@" > $WORKDIR/$name.c || return 1
+    lines=`wc -l < $WORKDIR/$name.c`
+    run=0
+    : > $WORKDIR/times
+
+    while [ $run -lt $RUNS ]; do
+	$SCC $OPTIONS -ftime-report < $WORKDIR/$name.c > /dev/null 2> $WORKDIR/report ||
+	    { echo "$name: compilation failed" 1>&2; return 1; }
+	grep -E ' KB$| s +[0-9.]+%$' $WORKDIR/report | sed 's/peak RSS/rss/' >> $WORKDIR/times
+	run=`expr $run + 1`
+    done
+
+    awk -v name=$name -v lines=$lines '
+	$3 == "s" { t[$1] = $2 * 1000 }
+	$1 == "total" && (best == "" || t["total"] < best) {
+	    best = t["total"]
+	    split("lexing parsing checking optimizing allocating generating", p)
+	    row = ""
+	    for (i = 1; i <= 6; i ++) row = row sprintf(" %.0f", t[p[i]])
+	}
+	$1 == "rss" { rss = $2 }
+	END { printf "%s %d%s %.0f %d\n", name, lines, row, best, rss }' $WORKDIR/times
+}
+
+
+echo "$cases" | while read name args; do
+    if [ -n "$name" ]; then
+	measure $name $args || exit 1
+    fi
+done > $WORKDIR/results || exit 1
+
+if [ $update = yes ]; then
+    { echo "# case total-ms peak-kb (scc $OPTIONS)"
+      awk '{ print $1, $9, $10 }' $WORKDIR/results; } > $BASELINE
+    echo "Wrote $BASELINE"
+    exit 0
+fi
+
+awk -v options="$OPTIONS" -v baseline=$BASELINE '
+    BEGIN {
+	while ((getline line < baseline) > 0)
+	    if (split(line, f) == 3 && f[1] !~ /^#/) {
+		bt[f[1]] = f[2]
+		bm[f[1]] = f[3]
+	    }
+    }
+
+    function change(now, before) {
+	return before > 0 ? sprintf("%+.0f%%", 100 * (now - before) / before) : "-"
+    }
+
+    FNR == 1 {
+	printf "scc %s, times in ms\n\n", options
+	printf "%-14s %6s %6s %6s %6s %6s %6s %6s %7s %7s %9s %8s %7s\n",
+	    "case", "lines", "lex", "parse", "check", "opt", "alloc", "gen",
+	    "total", "change", "lines/s", "peak KB", "change"
+    }
+
+    {
+	slow = bt[$1] > 0 && $9 > 1.25 * bt[$1] + 5 ? "  slower" : ""
+	printf "%-14s %6d %6d %6d %6d %6d %6d %6d %7d %7s %9.0f %8d %7s%s\n",
+	    $1, $2, $3, $4, $5, $6, $7, $8, $9, change($9, bt[$1]),
+	    ($9 > 0 ? $2 * 1000 / $9 : 0), $10, change($10, bm[$1]), slow
+    }' $WORKDIR/results
@@ -0,0 +1,89 @@
+/* matrix.c, scaled: multiply two n by n matrices */
+
+void free(), *malloc();
+int printf(), scanf();
+
+int **allocate(int n)
+{
+    int i;
+    int **a;
+
+    a = malloc(n * sizeof a[0]);
+
+    for (i = 0; i < n; i = i + 1)
+	a[i] = malloc(n * sizeof a[0][0]);
+
+    return a;
+}
+
+int initialize(int **a, int n, int k)
+{
+    int i, j;
+
+
+    for (i = 0; i < n; i = i + 1)
+	for (j = 0; j < n; j = j + 1)
+	    a[i][j] = (i * k + j) % 7 - 3;
+}
+
+int multiply(int **c, int **a, int **b, int n)
+{
+    int i, j, k, sum;
+
+
+    for (i = 0; i < n; i = i + 1)
+	for (j = 0; j < n; j = j + 1) {
+	    sum = 0;
+
+	    for (k = 0; k < n; k = k + 1)
+		sum = sum + a[i][k] * b[k][j];
+
+	    c[i][j] = sum;
+	}
+}
+
+int checksum(int **a, int n)
+{
+    int i, j, sum;
+
+
+    sum = 0;
+
+    for (i = 0; i < n; i = i + 1)
+	for (j = 0; j < n; j = j + 1)
+	    sum = (sum * 31 + a[i][j]) % 1000003;
+
+    return sum;
+}
+
+int deallocate(int **a, int n)
+{
+    int i;
+
+    i = 0;
+
+    while (i < n) {
+	free(a[i]);
+	i = i + 1;
+    }
+
+    free(a);
+}
+
+int main(void)
+{
+    int **a, **b, **c;
+    int n;
+
+    scanf("%d", &n);
+    a = allocate(n);
+    b = allocate(n);
+    c = allocate(n);
+    initialize(a, n, 3);
+    initialize(b, n, 5);
+    multiply(c, a, b, n);
+    printf("%d\n", checksum(c, n));
+    deallocate(a, n);
+    deallocate(b, n);
+    deallocate(c, n);
+}
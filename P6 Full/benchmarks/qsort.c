@@ -0,0 +1,115 @@
+/* qsort.c, scaled: sort n pseudorandom numbers */
+
+int n, seed;
+int *a;
+
+void *malloc();
+int printf(), scanf();
+
+
+/*
+ * return the next number from the minimal standard generator, computed
+ * without overflow (Schrage's method)
+ */
+
+int generate(void)
+{
+    int hi, lo;
+
+    hi = seed / 127773;
+    lo = seed % 127773;
+    seed = 16807 * lo - 2836 * hi;
+
+    if (seed <= 0)
+	seed = seed + 2147483647;
+
+    return seed;
+}
+
+int fillarray(void)
+{
+    int i;
+
+    i = 0;
+
+    while (i < n) {
+	a[i] = generate() % 1000000;
+	i = i + 1;
+    }
+}
+
+int checkarray(void)
+{
+    int i, sum;
+
+    i = 1;
+    sum = 0;
+
+    while (i < n) {
+	if (a[i - 1] > a[i])
+	    return -1;
+
+	sum = (sum + a[i] % 1000) % 1000003;
+	i = i + 1;
+    }
+
+    return sum;
+}
+
+int exchange(int *a, int *b)
+{
+    int t;
+
+    t = *a;
+    *a = *b;
+    *b = t;
+}
+
+int partition(int *a, int y, int z)
+{
+    int i, j, x;
+
+    x = a[y];
+    i = y - 1;
+    j = z + 1;
+
+    while (i < j) {
+	j = j - 1;
+
+	while (a[j] > x)
+	    j = j - 1;
+
+	i = i + 1;
+
+	while (a[i] < x)
+	    i = i + 1;
+
+	if (i < j)
+	    exchange(&a[i], &a[j]);
+    }
+
+    return j;
+}
+
+
+int quicksort(int *a, int m, int n)
+{
+    int i;
+
+    if (n > m) {
+	i = partition(a, m, n);
+	quicksort(a, m, i);
+	quicksort(a, i + 1, n);
+    }
+}
+
+
+int main(void)
+{
+    scanf("%d", &n);
+    seed = 1;
+    a = malloc(n * sizeof a[0]);
+    fillarray();
+    quicksort(a, 0, n - 1);
+    printf("%d\n", checkarray());
+}
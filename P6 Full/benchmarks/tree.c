@@ -0,0 +1,94 @@
+/*
+ * tree.c, scaled: insert n pseudorandom numbers into a binary search tree
+ * and then search for each of them and for as many others.
+ *
+ * Still no structures.  The data are pointers to the numbers.
+ */
+
+int printf(), scanf();
+void *malloc(), *null;
+int seed;
+
+int generate(void)
+{
+    int hi, lo;
+
+    hi = seed / 127773;
+    lo = seed % 127773;
+    seed = 16807 * lo - 2836 * hi;
+
+    if (seed <= 0)
+	seed = seed + 2147483647;
+
+    return seed;
+}
+
+void *insert(void **root, int *data)
+{
+    int *p;
+
+    if (!root) {
+	root = malloc(3 * sizeof root);
+	root[0] = data;
+	root[1] = null;
+	root[2] = null;
+	return root;
+    }
+
+    p = root[0];
+
+    if (*data < *p)
+	root[1] = insert(root[1], data);
+    else if (*data > *p)
+	root[2] = insert(root[2], data);
+
+    return root;
+}
+
+int search(void **root, int value)
+{
+    int *p;
+
+    while (root) {
+	p = root[0];
+
+	if (value == *p)
+	    return 1;
+
+	if (value < *p)
+	    root = root[1];
+	else
+	    root = root[2];
+    }
+
+    return 0;
+}
+
+int main(void)
+{
+    void **root;
+    int *a, i, n, found;
+
+    scanf("%d", &n);
+    a = malloc(n * sizeof a[0]);
+    seed = 1;
+    root = null;
+    i = 0;
+
+    while (i < n) {
+	a[i] = generate() % 1000000;
+	root = insert(root, &a[i]);
+	i = i + 1;
+    }
+
+    found = 0;
+    i = 0;
+
+    while (i < n) {
+	found = found + search(root, a[i]);
+	found = found + search(root, generate() % 1000000);
+	i = i + 1;
+    }
+
+    printf("%d\n", found);
+}
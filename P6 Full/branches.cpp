@@ -0,0 +1,310 @@
+/*
+ * File:	branches.cpp
+ *
+ * Description:	This file contains a tool for counting the branches a
+ *		program takes as it runs, for measuring how well the code
+ *		generated is laid out.  The program named is run with the
+ *		arguments given, reading the standard input and writing
+ *		the standard output as usual, and once it exits, the counts
+ *		are written to the standard error as a single line:
+ *
+ *		    branches: C conditional, T taken, J jumps
+ *
+ *		where C is the number of conditional branches executed, T
+ *		the number of those taken, and J the number of
+ *		unconditional jumps executed.  Only the code of the program
+ *		itself is counted, and not that of the libraries it calls.
+ *
+ *		The program is run at full speed until main is called, and
+ *		is then traced and run one instruction at a time,
+ *		which is slow, so each call into a library is instead run at
+ *		full speed up to a breakpoint at the return address.  The
+ *		library functions are bound when the program is loaded, so
+ *		that every call goes straight from the program to the
+ *		function.  Only x86-64 Linux programs are supported.
+ */
+
+# include <string>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <fstream>
+# include <iterator>
+# include <iostream>
+# include <unistd.h>
+
+# if defined(__linux__) && defined(__x86_64__)
+# include <elf.h>
+# include <sys/ptrace.h>
+# include <sys/user.h>
+# include <sys/wait.h>
+
+using namespace std;
+
+static pid_t child;
+static unsigned long low, high;
+static unsigned long conditionals, taken, jumps;
+
+
+/*
+ * Function:	fetch (private)
+ *
+ * Description:	Return the word at the given address in the program.
+ */
+
+static unsigned long fetch(unsigned long address)
+{
+    return ptrace(PTRACE_PEEKDATA, child, (void *) address, nullptr);
+}
+
+
+/*
+ * Function:	proceed (private)
+ *
+ * Description:	Resume the program, either for one instruction or until it
+ *		stops, returning false once it has exited.
+ */
+
+static bool proceed(enum __ptrace_request request)
+{
+    int status;
+
+
+    ptrace(request, child, nullptr, nullptr);
+    waitpid(child, &status, 0);
+
+    if (WIFEXITED(status) || WIFSIGNALED(status))
+	return false;
+
+    if (WSTOPSIG(status) != SIGTRAP) {
+	cerr << "branches: program stopped by signal " << WSTOPSIG(status) << endl;
+	kill(child, SIGKILL);
+	return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	run (private)
+ *
+ * Description:	Run the program at full speed until it reaches the given
+ *		address, returning false if it exits first.
+ */
+
+static bool run(unsigned long address)
+{
+    struct user_regs_struct regs;
+    unsigned long word = fetch(address);
+
+
+    ptrace(PTRACE_POKEDATA, child, (void *) address, (void *) ((word & ~0xffUL) | 0xcc));
+
+    if (!proceed(PTRACE_CONT))
+	return false;
+
+    ptrace(PTRACE_POKEDATA, child, (void *) address, (void *) word);
+    ptrace(PTRACE_GETREGS, child, nullptr, &regs);
+    regs.rip = address;
+    ptrace(PTRACE_SETREGS, child, nullptr, &regs);
+    return true;
+}
+
+
+/*
+ * Function:	locate (private)
+ *
+ * Description:	Find the address of main and the range of addresses of
+ *		the code of the program, once it has been loaded.  Main is
+ *		found in the symbol table of the executable, and is moved
+ *		by as much as the entry point if the program is position
+ *		independent.
+ */
+
+static unsigned long locate(const string &path)
+{
+    string range, perms, offset, device, inode, name, image;
+    char real[4096];
+    unsigned long entry = 0, main = 0, pair[2];
+    const Elf64_Ehdr *header;
+    const Elf64_Shdr *sections;
+    const Elf64_Sym *symbols;
+    const char *strings;
+
+
+    ifstream auxv("/proc/" + to_string(child) + "/auxv", ios::binary);
+
+    while (auxv.read((char *) pair, sizeof(pair)) && pair[0] != AT_NULL)
+	if (pair[0] == AT_ENTRY)
+	    entry = pair[1];
+
+    if (realpath(path.c_str(), real) == nullptr)
+	return 0;
+
+    ifstream file(real, ios::binary);
+    image.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+
+    if (image.size() < sizeof(Elf64_Ehdr))
+	return 0;
+
+    header = (const Elf64_Ehdr *) image.data();
+    sections = (const Elf64_Shdr *) (image.data() + header->e_shoff);
+
+    for (unsigned i = 0; i < header->e_shnum; i ++)
+	if (sections[i].sh_type == SHT_SYMTAB) {
+	    symbols = (const Elf64_Sym *) (image.data() + sections[i].sh_offset);
+	    strings = image.data() + sections[sections[i].sh_link].sh_offset;
+
+	    for (unsigned j = 0; j < sections[i].sh_size / sizeof(Elf64_Sym); j ++)
+		if (strcmp(strings + symbols[j].st_name, "main") == 0)
+		    main = symbols[j].st_value + entry - header->e_entry;
+	}
+
+    ifstream maps("/proc/" + to_string(child) + "/maps");
+
+    while (maps >> range >> perms >> offset >> device >> inode) {
+	getline(maps, name);
+	name.erase(0, name.find_first_not_of(' '));
+
+	if (name == real && perms.find('x') != string::npos) {
+	    low = strtoul(range.c_str(), nullptr, 16);
+	    high = strtoul(range.c_str() + range.find('-') + 1, nullptr, 16);
+	}
+    }
+
+    return main;
+}
+
+
+/*
+ * Function:	trace (private)
+ *
+ * Description:	Run the program one instruction at a time, counting each
+ *		branch executed within its code, and whether it was taken.
+ *		A conditional branch is either two or six bytes long, so
+ *		it was taken if the next instruction is not the one after.
+ *		Whenever the program leaves its code, it has called a
+ *		library function, so we run until that function returns,
+ *		or, if main itself has returned, until the program exits.
+ */
+
+static void trace()
+{
+    struct user_regs_struct regs;
+    unsigned long pc, word;
+    unsigned length;
+    bool branch, jump;
+
+
+    ptrace(PTRACE_GETREGS, child, nullptr, &regs);
+
+    while (true) {
+	pc = regs.rip;
+	word = fetch(pc);
+	branch = jump = false;
+	length = 0;
+
+	if ((word & 0xf0) == 0x70) {
+	    branch = true;
+	    length = 2;
+	} else if ((word & 0xff) == 0x0f && (word & 0xf000) == 0x8000) {
+	    branch = true;
+	    length = 6;
+	} else if ((word & 0xff) == 0xeb || (word & 0xff) == 0xe9)
+	    jump = true;
+
+	if (!proceed(PTRACE_SINGLESTEP))
+	    return;
+
+	ptrace(PTRACE_GETREGS, child, nullptr, &regs);
+
+	if (branch) {
+	    conditionals ++;
+	    taken += regs.rip != pc + length;
+	} else if (jump)
+	    jumps ++;
+
+	if (regs.rip < low || regs.rip >= high) {
+	    word = fetch(regs.rsp);
+
+	    if (word < low || word >= high) {
+		while (proceed(PTRACE_CONT))
+		    continue;
+
+		return;
+	    }
+
+	    if (!run(word))
+		return;
+
+	    ptrace(PTRACE_GETREGS, child, nullptr, &regs);
+	}
+    }
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Run the program given and report its branches.
+ */
+
+int main(int argc, char *argv[])
+{
+    unsigned long main;
+    int status;
+
+
+    if (argc < 2) {
+	cerr << "usage: branches program [argument ...]" << endl;
+	return EXIT_FAILURE;
+    }
+
+    if ((child = fork()) == 0) {
+	ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+	setenv("LD_BIND_NOW", "1", 1);
+	execv(argv[1], argv + 1);
+	perror(argv[1]);
+	_exit(EXIT_FAILURE);
+    }
+
+    waitpid(child, &status, 0);
+
+    if (WIFEXITED(status))
+	return WEXITSTATUS(status);
+
+    main = locate(argv[1]);
+
+    if (main == 0 || low == high) {
+	cerr << "branches: cannot find main in " << argv[1] << endl;
+	kill(child, SIGKILL);
+	return EXIT_FAILURE;
+    }
+
+    if (run(main))
+	trace();
+
+    cerr << "branches: " << conditionals << " conditional, " << taken;
+    cerr << " taken, " << jumps << " jumps" << endl;
+    return EXIT_SUCCESS;
+}
+
+# else
+
+using namespace std;
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Report that branches cannot be counted here.
+ */
+
+int main()
+{
+    cerr << "branches: only x86-64 Linux is supported" << endl;
+    return EXIT_FAILURE;
+}
+
+# endif
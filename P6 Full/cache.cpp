@@ -0,0 +1,195 @@
+/*
+ * File:	cache.cpp
+ *
+ * Description:	This file contains the public and private function
+ *		definitions for caching the code generated for each
+ *		function on disk, so that a function left unchanged since
+ *		an earlier compilation need not have code generated again.
+ *
+ *		The key for a function is its tree as written by the
+ *		writer, just before code would be generated, together with
+ *		the types of any global symbols it may refer to and the
+ *		options that affect the code generated.  The code is
+ *		stored in a file named by a hash of the key.  The file
+ *		also holds the key itself, so a collision is never taken
+ *		as a hit, and the labels of the string literals used, as
+ *		these are written out with the global declarations.  Since
+ *		each label is qualified by the name of its function, the
+ *		code is valid in any translation unit.
+ */
+
+# include <set>
+# include <cctype>
+# include <cstdio>
+# include <thread>
+# include <sstream>
+# include <fstream>
+# include <unistd.h>
+# include "options.h"
+# include "cache.h"
+
+using namespace std;
+
+
+/*
+ * Function:	signatures
+ *
+ * Description:	Return the type of each global symbol, including the
+ *		types of the parameters if it is a function, indexed by
+ *		name.
+ */
+
+Signatures signatures(const Scope *globals)
+{
+    Signatures result;
+
+    for (auto symbol : globals->symbols()) {
+	const Type &type = symbol->type();
+	stringstream ss;
+
+	ss << symbol->name() << ": " << type;
+
+	if (type.isFunction() && type.parameters() != nullptr) {
+	    ss << " (";
+
+	    for (auto &param : *type.parameters())
+		ss << " " << param;
+
+	    ss << " )";
+	}
+
+	result[symbol->name()] = ss.str();
+    }
+
+    return result;
+}
+
+
+/*
+ * Function:	fingerprint
+ *
+ * Description:	Return the key for a function.  Any identifier in the
+ *		tree that names a global symbol may refer to it, which is
+ *		conservative, as a local variable may hide the global.
+ */
+
+string fingerprint(const Function *function, const Signatures &globals)
+{
+    stringstream key, tree;
+    set<string> seen;
+    string text, name;
+
+
+    key << codegenOptions() << endl;
+
+    function->write(tree);
+    text = tree.str();
+    key << text << endl;
+
+    for (unsigned i = 0; i < text.size(); i ++)
+	if (isalpha(text[i]) || text[i] == '_') {
+	    name.clear();
+
+	    while (i < text.size() && (isalnum(text[i]) || text[i] == '_'))
+		name += text[i ++];
+
+	    if (seen.insert(name).second && globals.count(name) > 0)
+		key << globals.at(name) << endl;
+	}
+
+    return key.str();
+}
+
+
+/*
+ * Function:	path (private)
+ *
+ * Description:	Return the name of the file in the cache for a key, which
+ *		is named by its 64-bit FNV-1a hash.
+ */
+
+static string path(const string &key)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    char buf[20];
+
+
+    for (unsigned char c : key) {
+	hash ^= c;
+	hash *= 1099511628211ULL;
+    }
+
+    snprintf(buf, sizeof(buf), "%016llx", hash);
+    return cachedir + "/" + buf + ".s";
+}
+
+
+/*
+ * Function:	fetch
+ *
+ * Description:	Look up the code for a function in the cache, returning
+ *		whether it was found.  The labels of its string literals
+ *		are recreated for the function.
+ */
+
+bool fetch(const string &key, const Function *function, string &text, Strings &strings)
+{
+    ifstream file(path(key));
+    string line, literal;
+    unsigned count, number;
+    size_t length;
+
+
+    if (!file || !(file >> length) || file.get() != '\n')
+	return false;
+
+    string stored(length, '\0');
+
+    if (!file.read(&stored[0], length) || stored != key)
+	return false;
+
+    if (!(file >> count) || file.get() != '\n')
+	return false;
+
+    for (unsigned i = 0; i < count; i ++) {
+	if (!(file >> number) || file.get() != ' ' || !getline(file, literal))
+	    return false;
+
+	strings[literal] = new Label(function->id()->name(), number);
+    }
+
+    text.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    return true;
+}
+
+
+/*
+ * Function:	store
+ *
+ * Description:	Store the code for a function in the cache.  The file is
+ *		written under a temporary name and then renamed, so that
+ *		other compilations sharing the cache never see it partly
+ *		written.
+ */
+
+void store(const string &key, const string &text, const Strings &strings)
+{
+    string name = path(key), temp;
+    ofstream file;
+
+
+    temp = name + "." + to_string(getpid()) + "." + to_string(hash<thread::id>()(this_thread::get_id()));
+    file.open(temp);
+
+    file << key.size() << endl << key;
+    file << strings.size() << endl;
+
+    for (auto &literal : strings)
+	file << literal.second->number() << " " << literal.first << endl;
+
+    file << text;
+    file.close();
+
+    if (!file || rename(temp.c_str(), name.c_str()) != 0)
+	remove(temp.c_str());
+}
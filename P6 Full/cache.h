@@ -0,0 +1,24 @@
+/*
+ * File:	cache.h
+ *
+ * Description:	This file contains the function declarations for caching
+ *		the code generated for each function on disk.
+ */
+
+# ifndef CACHE_H
+# define CACHE_H
+# include <map>
+# include <string>
+# include "Scope.h"
+# include "Label.h"
+# include "Tree.h"
+
+typedef std::map<std::string, Label *> Strings;
+typedef std::map<std::string, std::string> Signatures;
+
+Signatures signatures(const Scope *globals);
+std::string fingerprint(const Function *function, const Signatures &globals);
+bool fetch(const std::string &key, const Function *function, std::string &text, Strings &strings);
+void store(const std::string &key, const std::string &text, const Strings &strings);
+
+# endif /* CACHE_H */
@@ -16,6 +16,8 @@
 # include <iostream>
 # include "lexer.h"
 # include "checker.h"
+# include "machine.h"
+# include "timing.h"
 # include "tokens.h"
 # include "Symbol.h"
 # include "Scope.h"
@@ -24,7 +26,7 @@
 
 using namespace std;
 
-static Scope *outermost, *toplevel;
+static thread_local Scope *outermost, *toplevel;
 static const Type error, integer(INT), character(CHAR), voidptr(VOID, 1);
 
 static string redefined = "redefinition of '%s'";
@@ -65,12 +67,15 @@ static Type promote(Expression *&expr)
 /*
  * Function:	scale
  *
- * Description:	Scale the result of pointer arithmetic.
+ * Description:	Scale the integer operand of pointer arithmetic by the size
+ *		of the type pointed to.  Where pointers are wider than
+ *		integers, the result is then converted to the pointer type,
+ *		so that both operands of the addition are the same width.
  */
 
-static Expression *scale(Expression *expr, unsigned size)
+static Expression *scale(Expression *expr, const Type &pointer)
 {
-    unsigned value;
+    unsigned value, size = pointer.deref().size();
 
 
     if (expr->isNumber(value)) {
@@ -78,7 +83,12 @@ static Expression *scale(Expression *expr, unsigned size)
 	return new Number(value * size);
     }
 
-    return new Multiply(expr, new Number(size), integer);
+    expr = new Multiply(expr, new Number(size), integer);
+
+    if (SIZEOF_PTR != SIZEOF_INT)
+	expr = new Cast(expr, pointer);
+
+    return expr;
 }
 
 
@@ -103,13 +113,18 @@ Scope *openScope()
  * Function:	closeScope
  *
  * Description:	Remove the top-level scope, and make its enclosing scope
- *		the new top-level scope.
+ *		the new top-level scope.  Once the outermost scope has been
+ *		removed, the next scope opened will be the outermost.
  */
 
 Scope *closeScope()
 {
     Scope *old = toplevel;
     toplevel = toplevel->enclosing();
+
+    if (toplevel == nullptr)
+	outermost = nullptr;
+
     return old;
 }
 
@@ -120,7 +135,8 @@ Scope *closeScope()
  * Description:	Define a function with the specified NAME and TYPE.  A
  *		function is always defined in the outermost scope.  This
  *		definition always replaces any previous definition or
- *		declaration.
+ *		declaration.  The previous symbol is not deleted, since
+ *		calls already parsed may still refer to it.
  */
 
 Symbol *defineFunction(const string &name, const Type &type)
@@ -136,7 +152,6 @@ Symbol *defineFunction(const string &name, const Type &type)
 	    report(conflicting, name);
 
 	outermost->remove(name);
-	delete symbol;
     }
 
     symbol = new Symbol(name, type);
@@ -210,6 +225,7 @@ Symbol *declareVariable(const string &name, const Type &type)
 
 Symbol *checkIdentifier(const string &name)
 {
+    PhaseTimer timer(CHECKING);
     Symbol *symbol = toplevel->lookup(name);
 
     if (symbol == nullptr) {
@@ -232,6 +248,7 @@ Symbol *checkIdentifier(const string &name)
 
 Expression *checkCall(Symbol *id, Expressions &args)
 {
+    PhaseTimer timer(CHECKING);
     const Type &t = id->type();
     Type result = error;
     Parameters *params;
@@ -280,12 +297,13 @@ Expression *checkCall(Symbol *id, Expressions &args)
 
 Expression *checkArray(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     const Type &t1 = promote(left);
     const Type &t2 = promote(right);
     Type result = error;
 
     if (t1.isPointer())
-	right = scale(right, t1.deref().size());
+	right = scale(right, t1);
 
     Expression *expr = new Add(left, right, t1);
 
@@ -309,6 +327,7 @@ Expression *checkArray(Expression *left, Expression *right)
 
 Expression *checkNot(Expression *expr)
 {
+    PhaseTimer timer(CHECKING);
     const Type &t = promote(expr);
     Type result = error;
 
@@ -333,6 +352,7 @@ Expression *checkNot(Expression *expr)
 
 Expression *checkNegate(Expression *expr)
 {
+    PhaseTimer timer(CHECKING);
     const Type &t = promote(expr);
     Type result = error;
 
@@ -357,6 +377,7 @@ Expression *checkNegate(Expression *expr)
 
 Expression *checkDereference(Expression *expr)
 {
+    PhaseTimer timer(CHECKING);
     const Type &t = promote(expr);
     Type result = error;
 
@@ -382,6 +403,7 @@ Expression *checkDereference(Expression *expr)
 
 Expression *checkAddress(Expression *expr)
 {
+    PhaseTimer timer(CHECKING);
     const Type &t = expr->type();
     Type result = error;
 
@@ -406,6 +428,7 @@ Expression *checkAddress(Expression *expr)
 
 Expression *checkSizeof(Expression *expr)
 {
+    PhaseTimer timer(CHECKING);
     const Type &t = expr->type();
 
 
@@ -452,6 +475,7 @@ Type checkMultiplicative(Expression *&left, Expression *&right, const string &op
 
 Expression *checkMultiply(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     Type t = checkMultiplicative(left, right, "*");
     return new Multiply(left, right, t);
 }
@@ -465,6 +489,7 @@ Expression *checkMultiply(Expression *left, Expression *right)
 
 Expression *checkDivide(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     Type t = checkMultiplicative(left, right, "/");
     return new Divide(left, right, t);
 }
@@ -477,6 +502,7 @@ Expression *checkDivide(Expression *left, Expression *right)
 
 Expression *checkRemainder(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     Type t = checkMultiplicative(left, right, "%");
     return new Remainder(left, right, t);
 }
@@ -492,6 +518,7 @@ Expression *checkRemainder(Expression *left, Expression *right)
 
 Expression *checkAdd(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     const Type &t1 = promote(left);
     const Type &t2 = promote(right);
     Type result = error;
@@ -502,11 +529,11 @@ Expression *checkAdd(Expression *left, Expression *right)
 	    result = t1;
 
 	else if (t1.isPointer() && t1 != voidptr && t2 == integer) {
-	    right = scale(right, t1.deref().size());
+	    right = scale(right, t1);
 	    result = t1;
 
 	} else if (t1 == integer && t2.isPointer() && t2 != voidptr) {
-	    left = scale(left, t2.deref().size());
+	    left = scale(left, t2);
 	    result = t2;
 
 	} else
@@ -529,6 +556,7 @@ Expression *checkAdd(Expression *left, Expression *right)
 
 Expression *checkSubtract(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     Expression *tree;
     const Type &t1 = promote(left);
     const Type &t2 = promote(right);
@@ -544,7 +572,7 @@ Expression *checkSubtract(Expression *left, Expression *right)
 	    result = integer;
 
 	else if (t1.isPointer() && t1 != voidptr && t2 == integer) {
-	    right = scale(right, t1.deref().size());
+	    right = scale(right, t1);
 	    result = t1;
 
 	} else
@@ -595,6 +623,7 @@ Type checkRelational(Expression *&left, Expression *&right, const string &op)
 
 Expression *checkLessThan(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     Type t = checkRelational(left, right, "<");
     return new LessThan(left, right, t);
 }
@@ -608,6 +637,7 @@ Expression *checkLessThan(Expression *left, Expression *right)
 
 Expression *checkGreaterThan(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     Type t = checkRelational(left, right, ">");
     return new GreaterThan(left, right, t);
 }
@@ -621,6 +651,7 @@ Expression *checkGreaterThan(Expression *left, Expression *right)
 
 Expression *checkLessOrEqual(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     Type t = checkRelational(left, right, "<=");
     return new LessOrEqual(left, right, t);
 }
@@ -634,6 +665,7 @@ Expression *checkLessOrEqual(Expression *left, Expression *right)
 
 Expression *checkGreaterOrEqual(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     Type t = checkRelational(left, right, ">=");
     return new GreaterOrEqual(left, right, t);
 }
@@ -673,6 +705,7 @@ Type checkEquality(Expression *&left, Expression *&right, const string &op)
 
 Expression *checkEqual(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     Type t = checkEquality(left, right, "==");
     return new Equal(left, right, t);
 }
@@ -686,6 +719,7 @@ Expression *checkEqual(Expression *left, Expression *right)
 
 Expression *checkNotEqual(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     Type t = checkEquality(left, right, "!=");
     return new NotEqual(left, right, t);
 }
@@ -726,6 +760,7 @@ Type checkLogical(Expression *&left, Expression *&right, const string &op)
 
 Expression *checkLogicalAnd(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     Type t = checkLogical(left, right, "&&");
     return new LogicalAnd(left, right, t);
 }
@@ -739,6 +774,7 @@ Expression *checkLogicalAnd(Expression *left, Expression *right)
 
 Expression *checkLogicalOr(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     Type t = checkLogical(left, right, "||");
     return new LogicalOr(left, right, t);
 }
@@ -753,6 +789,7 @@ Expression *checkLogicalOr(Expression *left, Expression *right)
 
 Statement *checkAssignment(Expression *left, Expression *right)
 {
+    PhaseTimer timer(CHECKING);
     const Type &t1 = left->type();
     const Type &t2 = promote(right);
 
@@ -779,6 +816,7 @@ Statement *checkAssignment(Expression *left, Expression *right)
 
 void checkReturn(Expression *&expr, const Type &type)
 {
+    PhaseTimer timer(CHECKING);
     const Type &t = promote(expr);
 
     if (t != error && !t.isCompatibleWith(type))
@@ -796,6 +834,7 @@ void checkReturn(Expression *&expr, const Type &type)
 
 void checkTest(Expression *&expr)
 {
+    PhaseTimer timer(CHECKING);
     const Type &t = promote(expr);
 
     if (t != error && !t.isValue())
@@ -0,0 +1,144 @@
+/*
+ * File:	client.cpp
+ *
+ * Description:	This file contains the main function of the thin client
+ *		for the Simple C compile server.  It is used in place of
+ *		the compiler itself, reading the source text from the
+ *		standard input and writing the assembly code to the
+ *		standard output, with any diagnostics written to the
+ *		standard error and the exit status that the compiler would
+ *		have had.  The path of the server's socket is given on the
+ *		command line or else in the SCC_SERVER environment
+ *		variable.
+ *
+ *		The client is deliberately kept small and uses nothing
+ *		from the compiler, so that it starts as quickly as
+ *		possible.
+ */
+
+# include <cstdio>
+# include <cerrno>
+# include <cstdlib>
+# include <cstring>
+# include <unistd.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+
+
+/*
+ * Function:	transfer (private)
+ *
+ * Description:	Copy the given bytes to a file descriptor, returning
+ *		whether they could all be written.
+ */
+
+static bool transfer(int fd, const char *data, size_t length)
+{
+    ssize_t n;
+
+    while (length > 0) {
+	n = write(fd, data, length);
+
+	if (n < 0 && errno == EINTR)
+	    continue;
+
+	if (n <= 0)
+	    return false;
+
+	data += n;
+	length -= n;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Send the standard input to the server and write out its
+ *		reply.  We fail if the reply is cut short or the assembly
+ *		code cannot be written, just as the compiler would.
+ */
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_un addr;
+    const char *path;
+    char buf[65536], *rest;
+    size_t length;
+    ssize_t n, have;
+    int fd, status;
+
+
+    path = argc > 1 ? argv[1] : getenv("SCC_SERVER");
+
+    if (path == nullptr || strlen(path) >= sizeof(addr.sun_path)) {
+	fprintf(stderr, "usage: scc-client PATH < file.c > file.s\n");
+	exit(EXIT_FAILURE);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+	perror(path);
+	exit(EXIT_FAILURE);
+    }
+
+    while ((n = read(0, buf, sizeof(buf))) > 0)
+	if (!transfer(fd, buf, n))
+	    break;
+
+    shutdown(fd, SHUT_WR);
+
+
+    /* The header line comes first and is short, so it fits in the buffer. */
+
+    have = 0;
+    buf[0] = '\0';
+
+    while ((n = read(fd, buf + have, sizeof(buf) - have - 1)) > 0) {
+	have += n;
+	buf[have] = '\0';
+
+	if (strchr(buf, '\n') != nullptr)
+	    break;
+    }
+
+    rest = strchr(buf, '\n');
+
+    if (rest == nullptr || sscanf(buf, "%d %zu", &status, &length) != 2) {
+	fprintf(stderr, "%s: invalid reply from server\n", path);
+	exit(EXIT_FAILURE);
+    }
+
+    rest ++;
+    have -= rest - buf;
+
+    while (true) {
+	size_t out = (size_t) have < length ? have : length;
+
+	if (!transfer(1, rest, out))
+	    status = EXIT_FAILURE;
+
+	transfer(2, rest + out, have - out);
+	length -= out;
+
+	if ((n = read(fd, buf, sizeof(buf))) <= 0)
+	    break;
+
+	rest = buf;
+	have = n;
+    }
+
+    if (length > 0) {
+	fprintf(stderr, "%s: incomplete reply from server\n", path);
+	exit(EXIT_FAILURE);
+    }
+
+    exit(status);
+}
@@ -0,0 +1,117 @@
+/*
+ * File:	compiler.cpp
+ *
+ * Description:	This file contains the public and private function
+ *		definitions for using the Simple C compiler as a library.
+ *
+ *		The source text is read in place, without being copied,
+ *		and the assembly code is handed to the sink in chunks as
+ *		it is written.
+ */
+
+# include <istream>
+# include <ostream>
+# include <streambuf>
+# include "compiler.h"
+# include "parser.h"
+# include "lexer.h"
+# include "storage.h"
+
+using namespace std;
+
+static const size_t chunk_size = 4096;
+
+
+/*
+ * Class:	SourceBuffer (private)
+ *
+ * Description:	A stream buffer for reading directly from memory.
+ */
+
+class SourceBuffer : public streambuf {
+public:
+    SourceBuffer(const char *source, size_t length) {
+	char *begin = const_cast<char *>(source);
+	setg(begin, begin, begin + length);
+    }
+};
+
+
+/*
+ * Class:	SinkBuffer (private)
+ *
+ * Description:	A stream buffer for writing to a sink, which is given
+ *		each chunk once it is full and whatever remains when the
+ *		stream is flushed.  The member function of the sink that
+ *		is called depends on whether this buffer is for assembly
+ *		code or for diagnostics.
+ */
+
+class SinkBuffer : public streambuf {
+    typedef void (Sink::*Method)(const char *, size_t);
+
+    Sink &_sink;
+    Method _method;
+    char _chunk[chunk_size];
+
+protected:
+    int overflow(int c) override {
+	sync();
+
+	if (c != EOF) {
+	    *pptr() = c;
+	    pbump(1);
+	}
+
+	return c == EOF ? 0 : c;
+    }
+
+    int sync() override {
+	if (pptr() > pbase())
+	    (_sink.*_method)(pbase(), pptr() - pbase());
+
+	setp(_chunk, _chunk + chunk_size);
+	return 0;
+    }
+
+public:
+    SinkBuffer(Sink &sink, Method method) : _sink(sink), _method(method) {
+	setp(_chunk, _chunk + chunk_size);
+    }
+};
+
+
+/*
+ * Function:	compile
+ *
+ * Description:	Compile the given source text, writing its assembly code
+ *		and diagnostics to the sink, and return whether it was
+ *		compiled without errors.  Any assembly code already given
+ *		to the sink must be discarded if not.  Everything the
+ *		compilation allocated is freed before returning, since
+ *		the caller may go on to compile many more.
+ */
+
+bool compile(const char *source, size_t length, Sink &sink)
+{
+    SourceBuffer input(source, length);
+    SinkBuffer output(sink, &Sink::write);
+    SinkBuffer errors(sink, &Sink::error);
+    istream in(&input);
+    ostream out(&output), err(&errors);
+    ostream *saved = diagnostics;
+    Storage *storage;
+    bool ok;
+
+
+    filename.clear();
+    diagnostics = &err;
+    storage = openStorage();
+    ok = translate(in, out) && numerrors == 0;
+    closeStorage(storage);
+    diagnostics = saved;
+
+    out.flush();
+    err.flush();
+    return ok;
+}
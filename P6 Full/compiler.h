@@ -0,0 +1,43 @@
+/*
+ * File:	compiler.h
+ *
+ * Description:	This file contains the class and function declarations
+ *		for using the Simple C compiler as a library.
+ *
+ *		A program embedding the compiler calls compile() with the
+ *		source text of a translation unit and a sink to which the
+ *		assembly code is written.  All of the state kept while
+ *		translating belongs to the calling thread, so different
+ *		threads may compile different sources at the same time,
+ *		and one thread may compile any number of sources in turn.
+ *		The price is that a compilation is tied to the thread that
+ *		started it: it cannot be suspended and resumed elsewhere,
+ *		and the threads it starts itself must adopt its state.
+ *		The options in options.h are shared by all compilations
+ *		and should be set before any is started.  The state of
+ *		-fpipeline is kept in pipeline.cpp for the whole process
+ *		rather than for a thread, so only one compilation at a
+ *		time may use it.
+ *		Diagnostics are handed to the sink separately from the
+ *		assembly code, and by default are written to the standard
+ *		error.
+ */
+
+# ifndef COMPILER_H
+# define COMPILER_H
+# include <cstddef>
+# include <iostream>
+
+class Sink {
+public:
+    virtual ~Sink() {}
+    virtual void write(const char *data, std::size_t length) = 0;
+
+    virtual void error(const char *data, std::size_t length) {
+	std::cerr.write(data, length);
+    }
+};
+
+bool compile(const char *source, std::size_t length, Sink &sink);
+
+# endif /* COMPILER_H */
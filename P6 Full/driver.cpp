@@ -0,0 +1,231 @@
+/*
+ * File:	driver.cpp
+ *
+ * Description:	This file contains the public and private function
+ *		definitions for compiling several files at once, and the
+ *		main function of the compiler.
+ *
+ *		Each file is a separate translation unit, which is
+ *		translated entirely on one thread.  All of the state kept
+ *		while translating a unit is local to its thread, so several
+ *		workers may each repeatedly claim the next file not yet
+ *		claimed and translate it.
+ */
+
+# include <atomic>
+# include <cstdlib>
+# include <thread>
+# include <cstdio>
+# include <fstream>
+# include <iostream>
+# include <sstream>
+# include "assembler.h"
+# include "interpreter.h"
+# include "jit.h"
+# include "parser.h"
+# include "driver.h"
+# include "options.h"
+# include "server.h"
+# include "lexer.h"
+# include "timing.h"
+
+using namespace std;
+
+
+/*
+ * Function:	output (private)
+ *
+ * Description:	Return the name of the assembly or object file for a
+ *		source file, which is placed in the output directory if one
+ *		was given.
+ */
+
+static string output(const string &file)
+{
+    string base = file;
+
+    if (!outdir.empty() && base.rfind('/') != string::npos)
+	base = base.substr(base.rfind('/') + 1);
+
+    if (base.size() > 2 && base.substr(base.size() - 2) == ".c")
+	base = base.substr(0, base.size() - 2);
+
+    base += object ? ".o" : ".s";
+
+    if (outdir.empty())
+	return base;
+
+    if (outdir.back() == '/')
+	return outdir + base;
+
+    return outdir + "/" + base;
+}
+
+
+/*
+ * Function:	emit (private)
+ *
+ * Description:	Translate the input, writing either the assembly code or,
+ *		with -c, the object file assembled from it.  An object file
+ *		is written only if there were no errors.
+ */
+
+static bool emit(istream &in, ostream &out)
+{
+    stringstream text;
+
+
+    if (!object)
+	return translate(in, out);
+
+    if (!translate(in, text) || numerrors > 0)
+	return false;
+
+    return assemble(text.str(), out);
+}
+
+
+/*
+ * Function:	execute (private)
+ *
+ * Description:	Translate the file named, or else the standard input, and
+ *		load the code into memory to be run, or the bytecode to be
+ *		interpreted, returning whether it was loaded.
+ */
+
+static bool execute()
+{
+    stringstream text;
+    ifstream file;
+
+
+    if (!files.empty()) {
+	filename = files[0];
+	file.open(files[0]);
+
+	if (!file) {
+	    cerr << files[0] << ": cannot open file" << endl;
+	    return false;
+	}
+    }
+
+    if (!translate(files.empty() ? cin : file, text) || numerrors > 0)
+	return false;
+
+    return interp ? loadProgram() : load(text.str());
+}
+
+
+/*
+ * Function:	compile (private)
+ *
+ * Description:	Compile a single file, returning whether it was compiled
+ *		without errors.  The assembly file is removed if not.
+ */
+
+static bool compile(const string &file)
+{
+    ifstream in(file);
+    string name;
+    bool ok;
+
+
+    filename = file;
+
+    if (!in) {
+	cerr << file << ": cannot open file" << endl;
+	return false;
+    }
+
+    name = output(file);
+    ofstream out(name);
+
+    if (!out) {
+	cerr << name << ": cannot create file" << endl;
+	return false;
+    }
+
+    ok = emit(in, out) && numerrors == 0;
+    out.close();
+
+    if (!ok)
+	remove(name.c_str());
+
+    return ok;
+}
+
+
+/*
+ * Function:	compileFiles
+ *
+ * Description:	Compile each of the given files using the number of jobs
+ *		requested, returning whether all were compiled without
+ *		errors.
+ */
+
+bool compileFiles(const vector<string> &files)
+{
+    vector<thread> workers;
+    atomic<unsigned> next(0);
+    atomic<bool> ok(true);
+
+
+    auto work = [&]() {
+	unsigned i;
+
+	while ((i = next ++) < files.size())
+	    if (!compile(files[i]))
+		ok = false;
+    };
+
+    if (jobs > 1) {
+	for (unsigned i = 0; i < jobs && i < files.size(); i ++)
+	    workers.push_back(thread(work));
+
+	for (auto &worker : workers)
+	    worker.join();
+    } else
+	work();
+
+    return ok;
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Translate the standard input stream, or each of the files
+ *		named on the command line, or else serve requests to
+ *		translate forever.  With --run or --interp, the program
+ *		translated is run once the time report, if any, has been
+ *		written, and its exit status is ours.
+ */
+
+int main(int argc, char *argv[])
+{
+    bool ok;
+
+
+    parseOptions(argc, argv);
+
+    if (!server.empty())
+	exit(runServer(server) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    if (jit || interp)
+	ok = execute();
+    else if (!files.empty())
+	ok = compileFiles(files);
+    else
+	ok = emit(cin, cout);
+
+    if (time_report)
+	printTimeReport(cerr);
+
+    if (jit && ok)
+	exit(run());
+
+    if (interp && ok)
+	exit(interpret());
+
+    exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,15 @@
+/*
+ * File:	driver.h
+ *
+ * Description:	This file contains the function declarations for
+ *		compiling several files at once.
+ */
+
+# ifndef DRIVER_H
+# define DRIVER_H
+# include <string>
+# include <vector>
+
+bool compileFiles(const std::vector<std::string> &files);
+
+# endif /* DRIVER_H */
@@ -0,0 +1,17 @@
+/* args.c */
+
+int printf(), add();
+
+int main(void)
+{
+    printf("%d\n", add(1, 2, 3, 4, 5, 6, 7, 8, 9, 10));
+    printf("%d\n", add(1, 2));
+}
+
+int add(int a)
+{
+    int b;
+
+    b = 10;
+    return a + b;
+}
@@ -6,28 +6,255 @@
  *
  *		Extra functionality:
  *		- putting all the global declarations at the end
+ *		- reusing values already computed within a basic block
+ *		- reusing the frame for calls in tail position
+ *		- optionally omitting the frame pointer
+ *		- generating code for functions in parallel
+ *		- reusing code cached from earlier compilations
+ *		- reusing code from the previous compilation of the file
+ *		- generating code for x86-64 with -m64
+ *		- rotating loops and laying out if statements so that the
+ *		  likely path falls through
+ *		- branching on conditions directly and threading jumps
+ *		- pooling string literals in read-only data, with a literal
+ *		  that is the tail of another sharing its storage
+ *		- counting how often code is run with -fprofile-generate
+ *		- laying out branches, keeping values across calls, and
+ *		  inlining by the counts with -fprofile-use
+ *
+ *		All of the state used while generating code for a function
+ *		is local to the thread doing so, including the output,
+ *		which is written to the standard output only once code for
+ *		every function has been generated.
+ *
+ *		On x86-64, the first six arguments are passed in registers,
+ *		which are stored in the frame on entry, and values needed
+ *		after a call may be kept in the registers a callee must
+ *		preserve.  These are saved in the frame on entry as well,
+ *		and restored before returning or jumping to another
+ *		function.  Globals and string literals are addressed
+ *		relative to %rip, so that the code is position independent.
+ *
+ *		When optimizing, each loop is rotated so that its test is
+ *		at the bottom, and an if statement whose then part is cold
+ *		is laid out so that the more frequent path falls through.
+ *		If there is no else part, the then part is moved after the
+ *		rest of the function.  The then part is cold if it returns
+ *		early, or, given a profile, if it is run less often than
+ *		not, whether optimizing or not.
+ *
+ *		When optimizing, a condition is also tested by branching
+ *		straight to where control goes, rather than computing its
+ *		value and testing that, and once the code for a function is
+ *		complete, branches to jumps are forwarded and branches that
+ *		are redundant or cannot be reached are removed.
+ *
+ *		With a profile, a value live across a call made less often
+ *		than the function is entered is spilled rather than kept
+ *		in a register the callee must preserve, which we would
+ *		have to save on every entry.
  */
 
+# include <map>
+# include <set>
+# include <unordered_map>
+# include <atomic>
+# include <algorithm>
+# include <thread>
 # include <cassert>
+# include <sstream>
 # include <iostream>
-# include <unordered_map>
+# include <typeinfo>
 # include "generator.h"
+# include "cache.h"
+# include "incremental.h"
+# include "options.h"
+# include "timing.h"
 # include "machine.h"
+# include "profile.h"
+# include "string.h"
+# include "storage.h"
+# include "lexer.h"
 # include "Tree.h"
 # include "Label.h"
 
 using namespace std;
 
-static int offset;
-static string funcname;
-static unordered_map<string, Label*> strings;
+static thread_local int offset;
+static thread_local int pushed;
+static thread_local int param_offset;
+static thread_local int reused;
+static thread_local unsigned threaded;
+static thread_local bool tailcalls;
+static thread_local unsigned argbytes;
+static thread_local unsigned outgoing;
+static thread_local unsigned long entries, weight;
+static thread_local string funcname;
+static thread_local Symbols params;
+static thread_local const Label *retlabel;
+static thread_local stringstream out, cold, notes;
+static thread_local map<string, Label *> strings;
+static thread_local map<string, vector<const Label *>> literals;
 static ostream &operator <<(ostream &ostr, Expression *expr);
 
-static Register *eax = new Register("%eax", "%al");
-static Register *ecx = new Register("%ecx", "%cl");
-static Register *edx = new Register("%edx", "%dl");
+static thread_local Register register_file[] = {
+    Register("%eax", "%al", "%rax"),
+    Register("%ecx", "%cl", "%rcx"),
+    Register("%edx", "%dl", "%rdx"),
+    Register("%esi", "%sil", "%rsi"),
+    Register("%edi", "%dil", "%rdi"),
+    Register("%r8d", "%r8b", "%r8"),
+    Register("%r9d", "%r9b", "%r9"),
+    Register("%r10d", "%r10b", "%r10"),
+    Register("%r11d", "%r11b", "%r11"),
+    Register("%ebx", "%bl", "%rbx"),
+    Register("%r12d", "%r12b", "%r12"),
+    Register("%r13d", "%r13b", "%r13"),
+    Register("%r14d", "%r14b", "%r14"),
+    Register("%r15d", "%r15b", "%r15")
+};
+
+static thread_local Register *eax = &register_file[0];
+static thread_local Register *ecx = &register_file[1];
+static thread_local Register *edx = &register_file[2];
+static thread_local Register *esi = &register_file[3];
+static thread_local Register *edi = &register_file[4];
+static thread_local Register *r8 = &register_file[5];
+static thread_local Register *r9 = &register_file[6];
+static thread_local Register *r10 = &register_file[7];
+static thread_local Register *r11 = &register_file[8];
+static thread_local Register *ebx = &register_file[9];
+static thread_local Register *r12 = &register_file[10];
+static thread_local Register *r13 = &register_file[11];
+static thread_local Register *r14 = &register_file[12];
+static thread_local Register *r15 = &register_file[13];
+
+static thread_local vector<Register *> registers = {eax, ecx, edx};
+static thread_local vector<Register *> parameters = {edi, esi, edx, ecx, r8, r9};
+static thread_local vector<Register *> callee = {ebx, r12, r13, r14, r15};
+static thread_local set<Register *> clobbered;
+
+static const string restore = "\t# restore\n";
+
+
+/*
+ * Function:	suffix (private)
+ *
+ * Description:	Return the suffix of an instruction operating on values of
+ *		the given size.
+ */
+
+static const char *suffix(unsigned size)
+{
+    return size == 1 ? "b" : size == 8 ? "q" : "l";
+}
+
+
+/*
+ * Function:	width (private)
+ *
+ * Description:	Return the size of the value of the given type when held
+ *		in a register, where a character is held as an integer.
+ */
+
+static unsigned width(const Type &type)
+{
+    return type.size() == SIZEOF_CHAR ? SIZEOF_INT : type.size();
+}
+
+
+/*
+ * Function:	forget (private)
+ *
+ * Description:	Forget the value held in a register, usually because an
+ *		instruction has overwritten it.
+ */
+
+static void forget(Register *reg)
+{
+    reg->_value.clear();
+    reg->_refs.clear();
+}
+
 
-static vector<Register *> registers = {eax, ecx, edx};
+/*
+ * Function:	remember (private)
+ *
+ * Description:	Remember that a register holds the value of the given
+ *		expression.  Expressions that have side effects, such as
+ *		function calls, have no signature and cannot be reused.
+ */
+
+static void remember(Register *reg, Expression *expr)
+{
+    stringstream sig;
+    References refs;
+
+    if (expr->signature(sig, refs)) {
+	reg->_value = sig.str();
+	reg->_refs = refs;
+    } else
+	forget(reg);
+}
+
+
+/*
+ * Function:	invalidate (private)
+ *
+ * Description:	Forget any values that might be changed by a store to the
+ *		given symbol, or by a store through a pointer if the symbol
+ *		is null.  Since we do not know what a pointer refers to, a
+ *		store through a pointer kills every value read from memory,
+ *		and a store to a variable kills every value read through a
+ *		pointer.
+ */
+
+static void invalidate(const Symbol *symbol)
+{
+    for (auto reg : registers)
+	for (auto ref : reg->_refs)
+	    if (symbol == nullptr || ref == nullptr || ref == symbol) {
+		forget(reg);
+		break;
+	    }
+}
+
+
+/*
+ * Function:	frame (private)
+ *
+ * Description:	Write the location at the given offset within our frame.
+ *		Without a frame pointer, the location is addressed relative
+ *		to the stack pointer, which is below the frame pointer by
+ *		the size of our frame plus whatever has since been pushed.
+ *		The size of our frame is not known until the end of the
+ *		function, so we leave it to the assembler.
+ */
+
+static ostream &frame(ostream &ostr, int where)
+{
+    if (omit_frame_pointer)
+	return ostr << where + pushed << "+" << funcname << ".size(" << stack_pointer << ")";
+
+    return ostr << where << "(" << frame_pointer << ")";
+}
+
+
+/*
+ * Function:	place (private)
+ *
+ * Description:	Place a label in the output.  A label starts a new basic
+ *		block, and since we do not know where control came from, we
+ *		forget the values held in all registers.
+ */
+
+static void place(const Label &label)
+{
+    out << label << ":" << endl;
+
+    for (auto reg : registers)
+	forget(reg);
+}
 
 
 void assign(Expression *expr, Register *reg) {
@@ -42,6 +269,12 @@ void assign(Expression *expr, Register *reg) {
            reg->_node->_register = nullptr;
        }
        reg->_node = expr;
+
+       if (expr != nullptr)
+           remember(reg, expr);
+
+       if (find(callee.begin(), callee.end(), reg) != callee.end())
+           clobbered.insert(reg);
    }
 }
 
@@ -49,17 +282,18 @@ void load(Expression *expr, Register *reg) {
     cerr << "load" << endl;
     if (reg->_node != expr) {
         if (reg->_node != nullptr) {
-            offset -= reg->_node->type().size();
+            count(SPILLS);
+            offset -= width(reg->_node->type());
             cerr << "offset: " << offset;
             reg->_node->_offset = offset;
-            cout << "\tmovl\t" << reg << ", ";
-            cout << offset << "(%ebp)" << endl;
+            out << "\tmov" << suffix(width(reg->_node->type())) << "\t" << reg->name(width(reg->_node->type())) << ", ";
+            frame(out, offset) << endl;
         }
 
     if (expr != nullptr) {
-        cout << (expr->type().size() == 1?
-            "\tmovsbl\t" : "\tmovl\t");
-        cout << expr << ", " << reg << endl;
+        out << (expr->type().size() == 1?
+            "\tmovsbl\t" : expr->type().size() == 8 ? "\tmovq\t" : "\tmovl\t");
+        out << expr << ", " << reg->name(width(expr->type())) << endl;
     }
         assign(expr, reg);
     }
@@ -76,6 +310,76 @@ Register *getreg() {
    load(nullptr, registers[0]);
    return registers[0];
 }
+
+
+/*
+ * Function:	evaluate (private)
+ *
+ * Description:	Generate code for an expression, unless a register already
+ *		holds its value, in which case we simply reuse the register.
+ *		If the register is in use, the value is copied, which is
+ *		only worth doing for an operator and not for an operand
+ *		that could be used directly.
+ */
+
+static void evaluate(Expression *expr)
+{
+    stringstream sig;
+    References refs;
+    Register *reg;
+    unsigned value, size;
+
+
+    if (optimize > 0 && !expr->isNumber(value) && expr->signature(sig, refs)) {
+	for (auto cached : registers)
+	    if (cached->_value == sig.str()) {
+		if (cached->_node == nullptr) {
+		    assign(expr, cached);
+		    reused ++;
+		    return;
+		}
+
+		if (sig.str()[0] == '(') {
+		    reg = getreg();
+		    size = width(expr->type());
+
+		    if (reg != cached)
+			out << "\tmov" << suffix(size) << "\t" << cached->name(size) << ", " << reg->name(size) << endl;
+
+		    assign(expr, reg);
+		    reused ++;
+		    return;
+		}
+	    }
+    }
+
+    expr->generate();
+}
+
+
+/*
+ * Function:	increment (private)
+ *
+ * Description:	Generate code to increment the given counter if the
+ *		program is being profiled.  The counters are 64 bits wide,
+ *		so on a 32-bit platform the carry is added to the high
+ *		word.  No register is used, so nothing need be forgotten.
+ */
+
+static void increment(unsigned counter)
+{
+    if (profile_generate.empty())
+	return;
+
+    if (m64)
+	out << "\tincq\t" << label_prefix << "profile.counters+" << 8 * counter << "(%rip)" << endl;
+    else {
+	out << "\taddl\t$1, " << label_prefix << "profile.counters+" << 8 * counter << endl;
+	out << "\tadcl\t$0, " << label_prefix << "profile.counters+" << 8 * counter + 4 << endl;
+    }
+}
+
+
 /*
  * Function:	align (private)
  *
@@ -118,7 +422,7 @@ static ostream &operator <<(ostream &ostr, Expression *expr)
 void Expression::operand(ostream &ostr) const
 {
     assert(_offset != 0);
-    ostr << _offset << "(%ebp)";
+    frame(ostr, _offset);
 }
 
 
@@ -130,10 +434,13 @@ void Expression::operand(ostream &ostr) const
 
 void Identifier::operand(ostream &ostr) const
 {
-    if (_symbol->_offset == 0)
+    if (_symbol->_offset == 0) {
 	ostr << global_prefix << _symbol->name();
-    else
-	ostr << _symbol->_offset << "(%ebp)";
+
+	if (m64)
+	    ostr << "(%rip)";
+    } else
+	frame(ostr, _symbol->_offset);
 }
 
 
@@ -154,12 +461,164 @@ void String::operand(ostream &ostr) const
         strings[_value] = new Label();
     }
     ostr << *(strings[_value]);
+
+    if (m64)
+        ostr << "(%rip)";
 }
 
 /*
- * Function:	Call::generate
+ * Function:	Expression::signature
  *
- * Description:	Generate code for a function call expression.
+ * Description:	Write a signature of an expression to the specified stream
+ *		and collect the symbols it reads, returning whether the
+ *		expression may be reused.  Two expressions with the same
+ *		signature compute the same value unless one of the symbols
+ *		read is changed in between.  A null symbol indicates that
+ *		the expression reads memory through a pointer.  By default,
+ *		an expression cannot be reused.
+ */
+
+bool Expression::signature(ostream &ostr, References &refs) const
+{
+    return false;
+}
+
+
+/*
+ * Function:	Identifier::signature
+ *
+ * Description:	Write the signature of an identifier, which depends upon
+ *		the symbol itself rather than its name, since different
+ *		scopes may declare the same name.
+ */
+
+bool Identifier::signature(ostream &ostr, References &refs) const
+{
+    ostr << _symbol;
+
+    if (_type.isScalar())
+	refs.push_back(_symbol);
+
+    return true;
+}
+
+
+/*
+ * Function:	Number::signature
+ *
+ * Description:	Write the signature of a number, which is just its value.
+ */
+
+bool Number::signature(ostream &ostr, References &refs) const
+{
+    ostr << "$" << _value;
+    return true;
+}
+
+
+/*
+ * Function:	String::signature
+ *
+ * Description:	Write the signature of a string literal, which is just its
+ *		value, since equal literals share the same label.
+ */
+
+bool String::signature(ostream &ostr, References &refs) const
+{
+    ostr << "\"" << _value << "\"";
+    return true;
+}
+
+
+/*
+ * Function:	Unary::signature
+ *
+ * Description:	Write the signature of a unary operator, which includes the
+ *		operator, the result type, and the signature of its operand.
+ */
+
+bool Unary::signature(ostream &ostr, References &refs) const
+{
+    ostr << "(" << typeid(*this).name() << " " << _type << " ";
+
+    if (!_expr->signature(ostr, refs))
+	return false;
+
+    ostr << ")";
+    return true;
+}
+
+
+/*
+ * Function:	Dereference::signature
+ *
+ * Description:	Write the signature of a dereference, which additionally
+ *		reads memory through a pointer.
+ */
+
+bool Dereference::signature(ostream &ostr, References &refs) const
+{
+    refs.push_back(nullptr);
+    return Unary::signature(ostr, refs);
+}
+
+
+/*
+ * Function:	Binary::signature
+ *
+ * Description:	Write the signature of a binary operator, which includes
+ *		the operator, the result type, and the signatures of both
+ *		operands.
+ */
+
+bool Binary::signature(ostream &ostr, References &refs) const
+{
+    ostr << "(" << typeid(*this).name() << " " << _type << " ";
+
+    if (!_left->signature(ostr, refs))
+	return false;
+
+    ostr << " ";
+
+    if (!_right->signature(ostr, refs))
+	return false;
+
+    ostr << ")";
+    return true;
+}
+
+
+/*
+ * Function:	LogicalAnd::signature
+ *
+ * Description:	A logical-and expression is never reused, since its code
+ *		spans several basic blocks.
+ */
+
+bool LogicalAnd::signature(ostream &ostr, References &refs) const
+{
+    return false;
+}
+
+
+/*
+ * Function:	LogicalOr::signature
+ *
+ * Description:	A logical-or expression is never reused, since its code
+ *		spans several basic blocks.
+ */
+
+bool LogicalOr::signature(ostream &ostr, References &refs) const
+{
+    return false;
+}
+
+
+/*
+ * Function:	push (private)
+ *
+ * Description:	Generate code to push the arguments of a call on the stack
+ *		on a 32-bit platform, returning the number of bytes pushed.
  *
  * 		On a 32-bit Linux platform, the stack needs to be aligned
  * 		on a 4-byte boundary.  (Online documentation seems to
@@ -180,170 +639,1190 @@ void String::operand(ostream &ostr) const
  *		calls, but generate code for ordinary arguments in place.
  */
 
-void Call::generate()
-{
-    cerr << "Call::generate" << endl;
-    unsigned numBytes;
+static unsigned push(const Expressions &_args)
+{
+    unsigned numBytes;
+
+
+    /* Generate code for any nested function calls first. */
+
+    numBytes = 0;
+
+    for (int i = _args.size() - 1; i >= 0; i --) {
+	numBytes += _args[i]->type().size();
+
+	if (STACK_ALIGNMENT != SIZEOF_ARG && _args[i]->_hasCall)
+	    evaluate(_args[i]);
+    }
+
+
+    /* Align the stack if necessary. */
+
+    if (align(numBytes) != 0) {
+	out << "\tsubl\t$" << align(numBytes) << ", %esp" << endl;
+	pushed += align(numBytes);
+	numBytes += align(numBytes);
+    }
+
+
+    /* Generate code for any remaining arguments and push them on the stack. */
+
+    for (int i = _args.size() - 1; i >= 0; i --) {
+	if (STACK_ALIGNMENT == SIZEOF_ARG || !_args[i]->_hasCall)
+	    evaluate(_args[i]);
+
+	out << "\tpushl\t" << _args[i] << endl;
+	pushed += _args[i]->type().size();
+	assign(_args[i], nullptr);
+
+    }
+
+    load(nullptr, eax);
+    load(nullptr, ecx);
+    load(nullptr, edx);
+    return numBytes;
+}
+
+
+/*
+ * Function:	store (private)
+ *
+ * Description:	Generate code to store the arguments of a call at the
+ *		bottom of our frame on a 32-bit platform, returning the
+ *		number of bytes pushed, which is none.  Space for the
+ *		arguments of the largest call is reserved once in the
+ *		prologue, so the stack pointer need not be adjusted for
+ *		each call.  Since a nested call would overwrite the
+ *		arguments already stored, the arguments with calls are
+ *		evaluated first.  Only the registers still live after the
+ *		arguments are stored are spilled.
+ */
+
+static unsigned store(const Expressions &args)
+{
+    unsigned numBytes, value;
+
+
+    numBytes = 0;
+
+    for (auto arg : args) {
+	numBytes += arg->type().size();
+
+	if (arg->_hasCall)
+	    evaluate(arg);
+    }
+
+    outgoing = max(outgoing, numBytes);
+    numBytes = 0;
+
+    for (auto arg : args) {
+	if (!arg->_hasCall)
+	    evaluate(arg);
+
+	if (arg->_register == nullptr && !arg->isNumber(value))
+	    load(arg, getreg());
+
+	out << "\tmovl\t" << arg << ", " << numBytes << "(%esp)" << endl;
+	numBytes += arg->type().size();
+	assign(arg, nullptr);
+    }
+
+    for (auto reg : registers)
+	load(nullptr, reg);
+
+    return 0;
+}
+
+
+/*
+ * Function:	pass (private)
+ *
+ * Description:	Generate code to pass the arguments of a call on x86-64,
+ *		returning the number of bytes pushed.  Every argument is
+ *		evaluated before any is passed, those with calls first.
+ *		The arguments after the first six are pushed on the stack,
+ *		or stored at the bottom of our frame when optimizing as on
+ *		a 32-bit platform, and the rest loaded into their
+ *		registers.  Any other value
+ *		in a register the callee may change is then moved to a
+ *		free register the callee must preserve, or else spilled.
+ *		With a profile, a register not yet used is not worth saving
+ *		on every entry if the call is made less often than that.
+ *		As on OS X, the stack must be aligned on a 16-byte boundary.
+ */
+
+static unsigned pass(const Expressions &args)
+{
+    unsigned i, numBytes;
+    Register *free;
+
+
+    for (auto arg : args)
+	if (arg->_hasCall)
+	    evaluate(arg);
+
+    for (auto arg : args)
+	if (!arg->_hasCall)
+	    evaluate(arg);
+
+
+    /* Store or push the arguments passed on the stack, aligning the
+       stack first if necessary. */
+
+    numBytes = 0;
+
+    if (args.size() > NUM_ARG_REGS)
+	numBytes = (args.size() - NUM_ARG_REGS) * SIZEOF_ARG;
+
+    if (optimize > 0) {
+	outgoing = max(outgoing, numBytes);
+
+	for (i = NUM_ARG_REGS; i < args.size(); i ++) {
+	    if (args[i]->_register == nullptr)
+		load(args[i], getreg());
+
+	    out << "\tmovq\t" << args[i]->_register->name(SIZEOF_ARG) << ", ";
+	    out << (i - NUM_ARG_REGS) * SIZEOF_ARG << "(%rsp)" << endl;
+	    assign(args[i], nullptr);
+	}
+
+	numBytes = 0;
+
+    } else if (align(numBytes) != 0) {
+	out << "\tsubq\t$" << align(numBytes) << ", %rsp" << endl;
+	pushed += align(numBytes);
+	numBytes += align(numBytes);
+    }
+
+    for (i = args.size(); optimize == 0 && i > NUM_ARG_REGS; i --) {
+	if (args[i - 1]->_register == nullptr)
+	    load(args[i - 1], getreg());
+
+	out << "\tpushq\t" << args[i - 1]->_register->name(SIZEOF_ARG) << endl;
+	pushed += SIZEOF_ARG;
+	assign(args[i - 1], nullptr);
+    }
+
+
+    /* Load the arguments passed in registers. */
+
+    for (i = 0; i < args.size() && i < NUM_ARG_REGS; i ++)
+	load(args[i], parameters[i]);
+
+
+    /* Preserve any other values held in registers across the call. */
+
+    for (auto reg : registers)
+	if (reg->_node != nullptr && find(callee.begin(), callee.end(), reg) == callee.end()
+		&& find(args.begin(), args.end(), reg->_node) == args.end()) {
+	    free = nullptr;
+
+	    for (auto saved : callee)
+		if (saved->_node == nullptr) {
+		    free = saved;
+		    break;
+		}
+
+	    if (free != nullptr && profiled() && weight < entries && clobbered.count(free) == 0)
+		free = nullptr;
+
+	    if (free != nullptr) {
+		out << "\tmovq\t" << reg->name(8) << ", " << free->name(8) << endl;
+		assign(reg->_node, free);
+	    } else
+		load(nullptr, reg);
+	}
+
+    for (i = 0; i < args.size() && i < NUM_ARG_REGS; i ++)
+	assign(args[i], nullptr);
+
+    out << "\tmovl\t$0, %eax" << endl;
+    return numBytes;
+}
+
+
+/*
+ * Function:	Call::generate
+ *
+ * Description:	Generate code for a function call expression.
+ */
+
+void Call::generate()
+{
+    cerr << "Call::generate" << endl;
+    unsigned numBytes;
+
+
+    /* Call the function and then reclaim the stack space. */
+
+    if (m64)
+	numBytes = pass(_args);
+    else
+	numBytes = optimize > 0 ? store(_args) : push(_args);
+    out << "\tcall\t" << global_prefix << _id->name() << endl;
+
+    for (auto reg : registers)
+	forget(reg);
+
+    if (numBytes > 0)
+	out << "\tadd" << suffix(SIZEOF_REG) << "\t$" << numBytes << ", " << stack_pointer << endl;
+
+    pushed -= numBytes;
+    assign(this, eax);
+    cerr << "Call::generate done" << endl;
+
+}
+
+
+/*
+ * Function:	tailcall (private)
+ *
+ * Description:	Generate code for a return of the result of a call,
+ *		returning whether it could be made as a tail call.  Rather
+ *		than building a new frame, the arguments are stored over our
+ *		own incoming arguments, so they must fit.  A call to
+ *		ourselves then simply jumps back to the start of our body,
+ *		and a call to another function tears down our frame and
+ *		jumps to the callee, which returns directly to our caller.
+ *		Every argument is evaluated before any is stored, since the
+ *		arguments may refer to our parameters, but a parameter
+ *		passed again in the same position need not be stored.
+ *
+ *		On x86-64, a call to ourselves stores the arguments in the
+ *		slots of our parameters, and a call to another function is
+ *		made only if all its arguments are passed in registers.
+ */
+
+static bool tailcall(Expression *expr)
+{
+    const Symbol *id, *symbol;
+    Expressions args;
+    unsigned numBytes, value, size;
+    vector<bool> stored;
+    vector<int> slots;
+    bool registered;
+    int slot;
+
+
+    if (!tailcalls || retlabel != nullptr || !expr->isCall(id, args))
+	return false;
+
+    numBytes = 0;
+
+    for (auto arg : args)
+	numBytes += arg->type().size();
+
+    registered = m64 && id->name() != funcname;
+
+    if (registered ? args.size() > NUM_ARG_REGS : numBytes > argbytes)
+	return false;
+
+
+    /* Evaluate all the arguments into registers or temporaries. */
+
+    slot = param_offset;
+
+    for (unsigned i = 0; i < args.size(); i ++) {
+	slots.push_back(m64 && !registered ? params[i]->_offset : slot);
+
+	if (!registered && args[i]->isIdentifier(symbol) && symbol->_offset == slots[i])
+	    stored.push_back(true);
+	else {
+	    stored.push_back(false);
+	    evaluate(args[i]);
+
+	    if (args[i]->_register == nullptr && !args[i]->isNumber(value))
+		load(args[i], getreg());
+	}
+
+	slot += args[i]->type().size();
+    }
+
+
+    /* Store the arguments over our incoming arguments, or pass them in
+       their registers. */
+
+    for (unsigned i = 0; i < args.size(); i ++) {
+	if (registered)
+	    load(args[i], parameters[i]);
+	else if (!stored[i]) {
+	    if (args[i]->_register == nullptr && !args[i]->isNumber(value))
+		load(args[i], getreg());
+
+	    size = width(args[i]->type());
+	    out << "\tmov" << suffix(size) << "\t";
+
+	    if (args[i]->_register != nullptr)
+		out << args[i]->_register->name(size) << ", ";
+	    else
+		out << args[i] << ", ";
+
+	    frame(out, slots[i]) << endl;
+	    assign(args[i], nullptr);
+	}
+    }
+
+    for (auto arg : args)
+	assign(arg, nullptr);
+
+    for (auto reg : registers)
+	forget(reg);
+
+
+    /* Jump to the start of the function called. */
+
+    if (id->name() == funcname)
+	out << "\tjmp\t" << global_prefix << funcname << ".entry" << endl;
+    else {
+	out << restore;
+
+	if (omit_frame_pointer)
+	    out << "\tadd" << suffix(SIZEOF_REG) << "\t$" << funcname << ".size, " << stack_pointer << endl;
+	else {
+	    out << "\tmov" << suffix(SIZEOF_REG) << "\t" << frame_pointer << ", " << stack_pointer << endl;
+	    out << "\tpop" << suffix(SIZEOF_REG) << "\t" << frame_pointer << endl;
+	}
+
+	if (m64)
+	    out << "\tmovl\t$0, %eax" << endl;
+
+	out << "\tjmp\t" << global_prefix << id->name() << endl;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	Inline::generate
+ *
+ * Description:	Generate code for an inlined function call.  The
+ *		arguments are first assigned to the parameters.  Like a
+ *		call, the body may use any register, so we spill them all
+ *		before generating the body.  A return statement within the
+ *		body jumps to the end of the body rather than the end of
+ *		the function, leaving its result in %eax.
+ */
+
+void Inline::generate()
+{
+    const Label *saved;
+    Label exitlabel;
+
+
+    for (auto param : _params)
+	param->generate();
+
+    for (auto reg : registers)
+	load(nullptr, reg);
+
+    saved = retlabel;
+    retlabel = &exitlabel;
+    _body->generate();
+    retlabel = saved;
+
+    place(exitlabel);
+    assign(this, eax);
+}
+
+
+/*
+ * Function:	Block::generate
+ *
+ * Description:	Generate code for this block, which simply means we
+ *		generate code for each statement within the block.
+ */
+
+void Block::generate()
+{
+    cerr << "Block::generate" << endl;
+    for (auto stmt : _stmts) {
+	stmt->generate();
+
+	for (auto reg : registers)
+	    assert(reg->_node == nullptr);
+    }
+    cerr << "Block::generate done" << endl;
+
+}
+
+
+/*
+ * Function:	Simple::generate
+ *
+ * Description:	Generate code for a simple (expression) statement, which
+ *		means simply generating code for the expression.
+ */
+
+void Simple::generate()
+{
+    cerr << "Simple::generate" << endl;
+    evaluate(_expr);
+    assign(_expr, nullptr);
+    cerr << "Simple::generate done" << endl;
+
+}
+
+
+/*
+ * Function:	threading (private)
+ *
+ * Description:	Return whether conditions are tested by branching to
+ *		where control goes and redundant branches are removed.
+ */
+
+static bool threading()
+{
+    return optimize > 0 && thread_jumps;
+}
+
+
+/*
+ * Function:	jump (private)
+ *
+ * Description:	Return whether the given line of assembly code is a branch
+ *		to a label, and if so, which branch and where it goes.
+ */
+
+static bool jump(const string &line, string &opcode, string &target)
+{
+    size_t tab;
+
+    if (line.compare(0, 2, "\tj") != 0 || (tab = line.find('\t', 1)) == string::npos)
+	return false;
+
+    opcode = line.substr(1, tab - 1);
+    target = line.substr(tab + 1);
+    return target[0] != '*';
+}
+
+
+/*
+ * Class:	Listing (private)
+ *
+ * Description:	The code for a function as lines of assembly code, with
+ *		the branch on each line and the labels picked out once and
+ *		the labels numbered, so that the jumps can be threaded
+ *		without parsing the lines again.  Lines are only marked as
+ *		removed, so that the line of each label stays valid, and
+ *		the branches to each label are counted as they change.
+ */
+
+class Listing {
+    unordered_map<string, int> _numbers;
+
+public:
+    vector<string> lines, opcodes, names;
+    vector<int> targets;
+    vector<size_t> labels;
+    vector<unsigned> uses;
+    vector<char> removed;
+
+    Listing(const string &text) {
+	string line, opcode, target;
+	size_t start, end;
+
+	for (start = 0; start < text.size(); start = end + 1) {
+	    if ((end = text.find('\n', start)) == string::npos)
+		end = text.size();
+
+	    line = text.substr(start, end - start);
+
+	    if (jump(line, opcode, target)) {
+		opcodes.push_back(opcode);
+		targets.push_back(number(target));
+		uses[targets.back()] ++;
+	    } else {
+		opcodes.push_back("");
+		targets.push_back(-1);
+	    }
+
+	    if (!line.empty() && line[0] != '\t')
+		labels[number(line.substr(0, line.size() - 1))] = lines.size();
+
+	    lines.push_back(line);
+	}
+
+	removed.assign(lines.size(), false);
+    }
+
+    int number(const string &name) {
+	auto it = _numbers.find(name);
+
+	if (it != _numbers.end())
+	    return it->second;
+
+	names.push_back(name);
+	labels.push_back(string::npos);
+	uses.push_back(0);
+	return _numbers[name] = names.size() - 1;
+    }
+
+    void branch(size_t i, const string &opcode, int target) {
+	uses[targets[i]] --;
+	uses[target] ++;
+	lines[i] = "\t" + opcode + "\t" + names[target];
+	opcodes[i] = opcode;
+	targets[i] = target;
+    }
+
+    void remove(size_t i) {
+	if (targets[i] >= 0)
+	    uses[targets[i]] --;
+
+	removed[i] = true;
+    }
+};
+
+
+/*
+ * Function:	following (private)
+ *
+ * Description:	Return the index of the first line after the given one
+ *		that is neither a label, blank, nor removed, and whether
+ *		any labels were passed over on the way.
+ */
+
+static size_t following(const Listing &code, size_t i, bool &labelled)
+{
+    for (labelled = false, i ++; i < code.lines.size(); i ++)
+	if (code.removed[i] || code.lines[i].empty())
+	    continue;
+	else if (code.lines[i][0] == '\t')
+	    break;
+	else
+	    labelled = true;
+
+    return i;
+}
+
+
+/*
+ * Function:	between (private)
+ *
+ * Description:	Return whether the given label lies between two lines,
+ *		so that control reaching the second passes through it.
+ */
+
+static bool between(const Listing &code, int label, size_t first, size_t second)
+{
+    return code.labels[label] > first && code.labels[label] < second;
+}
+
+
+/*
+ * Function:	destination (private)
+ *
+ * Description:	Return where a branch to the given label finally goes,
+ *		following any jumps at the label.  The destinations found
+ *		are remembered for every label along the way, so that
+ *		each chain of jumps is followed only once.
+ */
+
+static int destination(const Listing &code, vector<int> &destinations, int target)
+{
+    vector<int> chain;
+    bool labelled;
+    size_t k;
+
+
+    while (destinations[target] < 0 && code.labels[target] != string::npos && find(chain.begin(), chain.end(), target) == chain.end()) {
+	chain.push_back(target);
+	k = following(code, code.labels[target], labelled);
+
+	if (k == code.lines.size() || code.opcodes[k] != "jmp")
+	    break;
+
+	target = code.targets[k];
+    }
+
+    if (destinations[target] >= 0)
+	target = destinations[target];
+
+    for (auto label : chain)
+	destinations[label] = target;
+
+    return target;
+}
+
+
+/*
+ * Function:	threadJump (private)
+ *
+ * Description:	Make one pass over the code for a function, threading or
+ *		removing its branches, and return whether anything was
+ *		changed.  The number of branches removed is added to the
+ *		given count.  A branch to a label followed by a jump goes
+ *		where the jump goes, a branch to the code that follows
+ *		anyway is removed, as is a conditional branch followed by
+ *		a jump to the same place, and a conditional branch over a
+ *		jump is reversed to go where the jump goes.  Code after a
+ *		jump and before the next label cannot be reached, and
+ *		labels we generated that are not branched to are removed.
+ *		Every branch is threaded before any line is removed.
+ */
+
+static bool threadJump(Listing &code, unsigned &count)
+{
+    static const map<string, string> reverse = {
+	{"je", "jne"}, {"jne", "je"}, {"jl", "jge"}, {"jge", "jl"},
+	{"jle", "jg"}, {"jg", "jle"},
+    };
+
+    vector<int> destinations(code.names.size(), -1);
+    string local = label_prefix + funcname + ".";
+    bool changed = false, labelled;
+    size_t i, j, k;
+    int target;
+
+
+    for (target = 0; target < (int) code.names.size(); target ++) {
+	const string &name = code.names[target];
+
+	if (code.labels[target] != string::npos && !code.removed[code.labels[target]]
+		&& code.uses[target] == 0 && name.compare(0, local.size(), local) == 0
+		&& name.find_first_not_of("0123456789", local.size()) == string::npos) {
+	    code.remove(code.labels[target]);
+	    changed = true;
+	}
+    }
+
+    for (i = 0; i < code.lines.size(); i ++)
+	if (!code.removed[i] && code.targets[i] >= 0) {
+	    target = destination(code, destinations, code.targets[i]);
+
+	    if (target != code.targets[i]) {
+		code.branch(i, code.opcodes[i], target);
+		changed = true;
+	    }
+	}
+
+    for (i = 0; i < code.lines.size(); i ++) {
+	if (code.removed[i] || code.targets[i] < 0)
+	    continue;
+
+	j = following(code, i, labelled);
+
+	if (between(code, code.targets[i], i, j)) {
+	    code.remove(i);
+	    count ++;
+	    changed = true;
+	    continue;
+	}
+
+	if (code.opcodes[i] != "jmp" && !labelled && j < code.lines.size() && code.opcodes[j] == "jmp") {
+	    if (code.targets[j] == code.targets[i]) {
+		code.remove(i);
+		count ++;
+		changed = true;
+		continue;
+	    }
+
+	    k = following(code, j, labelled);
+
+	    if (between(code, code.targets[i], j, k) && reverse.count(code.opcodes[i]) > 0) {
+		code.branch(i, reverse.at(code.opcodes[i]), code.targets[j]);
+		code.remove(j);
+		count ++;
+		changed = true;
+		continue;
+	    }
+	}
+
+	if (code.opcodes[i] == "jmp" && !labelled && j < code.lines.size() && code.lines[j].compare(0, 2, "\t.") != 0) {
+	    for (k = j; k < code.lines.size(); k ++)
+		if (code.removed[k])
+		    continue;
+		else if (code.lines[k].empty() || code.lines[k][0] != '\t' || code.lines[k][1] == '.')
+		    break;
+		else {
+		    count += code.targets[k] >= 0;
+		    code.remove(k);
+		}
+
+	    changed = true;
+	}
+    }
+
+    return changed;
+}
+
+
+/*
+ * Function:	threadJumps (private)
+ *
+ * Description:	Thread the jumps in the code for a function until no
+ *		more can be, returning the number of branches removed.
+ *		Each pass threads every branch it can, so only a change
+ *		made possible by another, such as a label no longer used,
+ *		needs another pass.
+ */
+
+static unsigned threadJumps(string &text)
+{
+    Listing code(text);
+    unsigned count = 0;
+
+
+    while (threadJump(code, count))
+	continue;
+
+    text.clear();
+
+    for (size_t i = 0; i < code.lines.size(); i ++)
+	if (!code.removed[i])
+	    text += code.lines[i] + "\n";
+
+    return count;
+}
+
+
+/*
+ * Function:	Function::generate
+ *
+ * Description:	Generate code for this function, which entails allocating
+ *		space for local variables, then emitting our prologue, the
+ *		body of the function, and the epilogue.  On x86-64, the
+ *		prologue also stores the parameters passed in registers and
+ *		saves the registers we must preserve that the body uses.
+ *		When profiling, the prologue counts the call, and that of
+ *		main arranges for the counters to be written at exit.  Any
+ *		code moved out of line follows the body.  When optimizing,
+ *		the jumps in the finished code are then threaded.
+ */
+
+void Function::generate()
+{
+    cerr << "Function::generate" << endl;
+    stringstream saves, restores;
+    string body;
+    size_t where;
+    unsigned size;
+    PhaseTimer timer(GENERATING);
+
+
+    /* Assign offsets to the parameters and local variables.  Without
+       a frame pointer, there is no saved %ebp above the locals, and
+       our frame pointer is simply the stack pointer on entry. */
+
+    param_offset = (omit_frame_pointer ? 1 : 2) * SIZEOF_REG;
+    offset = param_offset;
+    allocate(offset);
+
+    if (m64)
+	registers = {eax, ecx, edx, esi, edi, r8, r9, r10, r11, ebx, r12, r13, r14, r15};
+
+    params.assign(_body->declarations()->symbols().begin(),
+	_body->declarations()->symbols().begin() + _id->type().parameters()->size());
+
+
+    /* Generate the body of this function, which we hold back until
+       we know whether we need a frame at all. */
+
+    funcname = _id->name();
+    Label::enter(_id->name());
+    reused = 0;
+    threaded = 0;
+    tailcalls = optimize > 0 && !_addressed;
+    argbytes = 0;
+    outgoing = 0;
+
+    for (auto &param : *_id->type().parameters())
+	argbytes += param.promote().size();
+
+    for (auto reg : registers)
+	forget(reg);
+
+    pushed = 0;
+    clobbered.clear();
+    strings.clear();
+    entries = weight = frequency(_counter);
+    cold.str("");
+    notes.str("");
+    out.str("");
+
+    _body->generate();
+
+    if (!cold.str().empty()) {
+	if (!_body->returns())
+	    out << "\tjmp\t" << funcname << ".exit" << endl;
+
+	out << cold.str();
+    }
+
+
+    /* Allocate space to save the registers we must preserve. */
 
+    for (auto reg : callee)
+	if (clobbered.count(reg) > 0) {
+	    offset -= SIZEOF_REG;
+	    saves << "\tmovq\t" << reg->name(SIZEOF_REG) << ", ";
+	    frame(saves, offset) << endl;
+	    restores << "\tmovq\t";
+	    frame(restores, offset) << ", " << reg->name(SIZEOF_REG) << endl;
+	}
 
-    /* Generate code for any nested function calls first. */
+    offset -= outgoing;
+    offset -= align(offset - param_offset);
+    body = out.str();
+    out.str("");
 
-    numBytes = 0;
+    while ((where = body.find(restore)) != string::npos)
+	body.replace(where, restore.size(), restores.str());
 
-    for (int i = _args.size() - 1; i >= 0; i --) {
-	numBytes += _args[i]->type().size();
 
-	if (STACK_ALIGNMENT != SIZEOF_ARG && _args[i]->_hasCall)
-	    _args[i]->generate();
-    }
+    /* Generate our prologue. */
 
+    out << global_prefix << funcname << ":" << endl;
 
-    /* Align the stack if necessary. */
+    if (!omit_frame_pointer) {
+	out << "\tpush" << suffix(SIZEOF_REG) << "\t" << frame_pointer << endl;
+	out << "\tmov" << suffix(SIZEOF_REG) << "\t" << stack_pointer << ", " << frame_pointer << endl;
+	out << "\tsub" << suffix(SIZEOF_REG) << "\t$" << funcname << ".size, " << stack_pointer << endl;
+    } else if (offset != 0)
+	out << "\tsub" << suffix(SIZEOF_REG) << "\t$" << funcname << ".size, " << stack_pointer << endl;
 
-    if (align(numBytes) != 0) {
-	cout << "\tsubl\t$" << align(numBytes) << ", %esp" << endl;
-	numBytes += align(numBytes);
+    for (unsigned i = 0; i < params.size() && i < NUM_ARG_REGS; i ++) {
+	size = params[i]->type().promote().size();
+	out << "\tmov" << suffix(size) << "\t" << parameters[i]->name(size) << ", ";
+	frame(out, params[i]->_offset) << endl;
     }
 
+    out << saves.str();
+    increment(_counter);
+
+    if (!profile_generate.empty() && funcname == "main") {
+	if (m64) {
+	    out << "\tleaq\t" << label_prefix << "profile.dump(%rip), %rdi" << endl;
+	    out << "\tcall\t" << global_prefix << "atexit" << endl;
+	} else {
+	    out << "\tpushl\t$" << label_prefix << "profile.dump" << endl;
+	    out << "\tcall\t" << global_prefix << "atexit" << endl;
+	    out << "\taddl\t$4, %esp" << endl;
+	}
+    }
 
-    /* Generate code for any remaining arguments and push them on the stack. */
+    if (tailcalls)
+	out << global_prefix << funcname << ".entry:" << endl;
 
-    for (int i = _args.size() - 1; i >= 0; i --) {
-	if (STACK_ALIGNMENT == SIZEOF_ARG || !_args[i]->_hasCall)
-	    _args[i]->generate();
+    out << body;
 
-	cout << "\tpushl\t" << _args[i] << endl;
-	assign(_args[i], nullptr);
 
-    }
+    /* Generate our epilogue. */
 
+    out << endl << global_prefix << funcname << ".exit:" << endl;
+    out << restores.str();
 
-    /* Call the function and then reclaim the stack space. */
+    if (!omit_frame_pointer) {
+	out << "\tmov" << suffix(SIZEOF_REG) << "\t" << frame_pointer << ", " << stack_pointer << endl;
+	out << "\tpop" << suffix(SIZEOF_REG) << "\t" << frame_pointer << endl;
+    } else if (offset != 0)
+	out << "\tadd" << suffix(SIZEOF_REG) << "\t$" << funcname << ".size, " << stack_pointer << endl;
 
-    load(nullptr, eax);
-    load(nullptr, ecx);
-    load(nullptr, edx);
+    out << "\tret" << endl << endl;
+    out << "\t.set\t" << funcname << ".size, " << -offset << endl;
+    out << "\t.globl\t" << global_prefix << funcname << endl << endl;
 
-    cout << "\tcall\t" << global_prefix << _id->name() << endl;
 
-    if (numBytes > 0)
-	cout << "\taddl\t$" << numBytes << ", %esp" << endl;
+    /* Thread the jumps in the function as a whole, now that the
+       labels of the prologue and epilogue are there as well. */
 
-    assign(this, eax);
-    cerr << "Call::generate done" << endl;
+    if (threading()) {
+	body = out.str();
+	threaded += threadJumps(body);
+	out.str(body);
+	out.seekp(0, ios::end);
+    }
+
+    if (optimize > 0 && opt_report)
+	notes << funcname << ": " << reused << " common subexpressions" << endl;
+
+    if (threading() && opt_report)
+	notes << funcname << ": " << threaded << " branches removed" << endl;
+    cerr << "Function::generate done" << endl;
 
 }
 
 
 /*
- * Function:	Block::generate
+ * Function:	instructions (private)
  *
- * Description:	Generate code for this block, which simply means we
- *		generate code for each statement within the block.
+ * Description:	Return the number of instructions in the given assembly
+ *		code, which are the lines indented that are not directives.
  */
 
-void Block::generate()
+static unsigned long instructions(const string &text)
 {
-    cerr << "Block::generate" << endl;
-    for (auto stmt : _stmts) {
-	stmt->generate();
+    unsigned long count = 0;
+    size_t i = 0;
 
-	for (auto reg : registers)
-	    assert(reg->_node == nullptr);
+    while (i < text.size()) {
+	if (text[i] == '\t' && i + 1 < text.size() && text[i + 1] != '.')
+	    count ++;
+
+	if ((i = text.find('\n', i)) == string::npos)
+	    break;
+
+	i ++;
     }
-    cerr << "Block::generate done" << endl;
 
+    return count;
 }
 
 
 /*
- * Function:	Simple::generate
+ * Function:	generateFunctions
  *
- * Description:	Generate code for a simple (expression) statement, which
- *		means simply generating code for the expression.
+ * Description:	Generate code for the functions of a translation unit,
+ *		writing it to the given stream in the order in which the
+ *		functions were defined.  The functions are independent
+ *		of each other, so we may use several threads, each of which
+ *		repeatedly claims the next function not yet claimed.  Each
+ *		function names its own labels, so the output is the same
+ *		no matter how many threads are used.  If a cache is used,
+ *		the given global scope is needed for the keys.  The reports
+ *		of the functions are likewise kept until the end and then
+ *		written to the diagnostic stream of the calling thread.
  */
 
-void Simple::generate()
+void generateFunctions(const Functions &functions, const Scope *globals, unsigned threads, ostream &ostr)
 {
-    cerr << "Simple::generate" << endl;
-    _expr->generate();
-    assign(_expr, nullptr);
-    cerr << "Simple::generate done" << endl;
+    vector<string> text(functions.size());
+    vector<string> reports(functions.size());
+    vector<map<string, Label *>> tables(functions.size());
+    vector<thread> workers;
+    atomic<unsigned> next(0), hits(0);
+    Signatures signed_globals;
+    Storage *storage = currentStorage();
+
+
+    auto work = [&]() {
+	unsigned i;
+	string key;
+
+	useStorage(storage);
+
+	while ((i = next ++) < functions.size()) {
+	    if (!snapshot.empty() && reuse(functions[i], text[i], tables[i]))
+		continue;
+
+	    if (!cachedir.empty()) {
+		key = fingerprint(functions[i], signed_globals);
+
+		if (fetch(key, functions[i], text[i], tables[i])) {
+		    hits ++;
+
+		    if (!snapshot.empty())
+			record(functions[i], text[i], tables[i]);
+
+		    continue;
+		}
+	    }
+
+	    functions[i]->generate();
+	    text[i] = out.str();
+	    reports[i] = notes.str();
+	    tables[i] = strings;
+
+	    if (!cachedir.empty())
+		store(key, text[i], tables[i]);
 
+	    if (!snapshot.empty())
+		record(functions[i], text[i], tables[i]);
+	}
+    };
+
+    if (!cachedir.empty())
+	signed_globals = signatures(globals);
+
+    if (threads > 1) {
+	for (unsigned i = 0; i < threads; i ++)
+	    workers.push_back(thread(work));
+
+	for (auto &worker : workers)
+	    worker.join();
+    } else
+	work();
+
+    for (unsigned i = 0; i < functions.size(); i ++) {
+	ostr << text[i];
+	*diagnostics << reports[i];
+
+	if (time_report)
+	    count(INSTRUCTIONS, instructions(text[i]));
+
+	for (auto &literal : tables[i])
+	    literals[literal.first].push_back(literal.second);
+    }
+
+    if (!cachedir.empty() && opt_report) {
+	*diagnostics << "cache: " << hits << " of " << functions.size();
+	*diagnostics << " functions reused" << endl;
+    }
 }
 
 
 /*
- * Function:	Function::generate
+ * Function:	profiler (private)
  *
- * Description:	Generate code for this function, which entails allocating
- *		space for local variables, then emitting our prologue, the
- *		body of the function, and the epilogue.
+ * Description:	Generate the counters of a program being profiled and
+ *		the function that main registers with atexit to write them
+ *		to the profile.  The counters and the function are local
+ *		to the translation unit.
  */
 
-void Function::generate()
+static void profiler(ostream &ostr)
 {
-    cerr << "Function::generate" << endl;
-    int param_offset;
+    const string prefix = string(label_prefix) + "profile.";
+    unsigned n = numCounters();
+
+
+    ostr << "\t.lcomm\t" << prefix << "counters, " << 8 * n << endl;
+    ostr << "\t.text" << endl;
+    ostr << prefix << "dump:" << endl;
+
+    if (m64) {
+	ostr << "\tsubq\t$8, %rsp" << endl;
+	ostr << "\tleaq\t" << prefix << "file(%rip), %rdi" << endl;
+	ostr << "\tleaq\t" << prefix << "mode(%rip), %rsi" << endl;
+	ostr << "\tcall\t" << global_prefix << "fopen" << endl;
+	ostr << "\tcmpq\t$0, %rax" << endl;
+	ostr << "\tje\t" << prefix << "done" << endl;
+	ostr << "\tmovq\t%rax, (%rsp)" << endl;
+	ostr << "\tleaq\t" << prefix << "counters(%rip), %rdi" << endl;
+	ostr << "\tmovl\t$8, %esi" << endl;
+	ostr << "\tmovl\t$" << n << ", %edx" << endl;
+	ostr << "\tmovq\t%rax, %rcx" << endl;
+	ostr << "\tcall\t" << global_prefix << "fwrite" << endl;
+	ostr << "\tmovq\t(%rsp), %rdi" << endl;
+	ostr << "\tcall\t" << global_prefix << "fclose" << endl;
+	ostr << prefix << "done:" << endl;
+	ostr << "\taddq\t$8, %rsp" << endl;
+    } else {
+	ostr << "\tpushl\t$" << prefix << "mode" << endl;
+	ostr << "\tpushl\t$" << prefix << "file" << endl;
+	ostr << "\tcall\t" << global_prefix << "fopen" << endl;
+	ostr << "\taddl\t$8, %esp" << endl;
+	ostr << "\tcmpl\t$0, %eax" << endl;
+	ostr << "\tje\t" << prefix << "done" << endl;
+	ostr << "\tpushl\t%eax" << endl;
+	ostr << "\tpushl\t%eax" << endl;
+	ostr << "\tpushl\t$" << n << endl;
+	ostr << "\tpushl\t$8" << endl;
+	ostr << "\tpushl\t$" << prefix << "counters" << endl;
+	ostr << "\tcall\t" << global_prefix << "fwrite" << endl;
+	ostr << "\taddl\t$16, %esp" << endl;
+	ostr << "\tcall\t" << global_prefix << "fclose" << endl;
+	ostr << "\taddl\t$4, %esp" << endl;
+	ostr << prefix << "done:" << endl;
+    }
 
+    ostr << "\tret" << endl;
+    ostr << "\t.data" << endl;
+    ostr << prefix << "file:" << endl;
+    ostr << "\t.asciz\t\"";
 
-    /* Assign offsets to the parameters and local variables. */
+    for (auto c : profile_generate) {
+	if (c == '"' || c == '\\')
+	    ostr << '\\';
 
-    param_offset = 2 * SIZEOF_REG;
-    offset = param_offset;
-    allocate(offset);
+	ostr << c;
+    }
 
+    ostr << "\"" << endl;
+    ostr << prefix << "mode:" << endl;
+    ostr << "\t.asciz\t\"wb\"" << endl;
+}
 
-    /* Generate our prologue. */
 
-    funcname = _id->name();
-    cout << global_prefix << funcname << ":" << endl;
-    cout << "\tpushl\t%ebp" << endl;
-    cout << "\tmovl\t%esp, %ebp" << endl;
-    cout << "\tsubl\t$" << funcname << ".size, %esp" << endl;
+/*
+ * Function:	pool (private)
+ *
+ * Description:	Generate the string literals into the read-only data
+ *		section.  A literal used by several functions has a label
+ *		from each of them, and literals with the same bytes, once
+ *		their escape sequences are parsed, are stored once.  A
+ *		literal that is the tail of another, as "\n" is of "%d\n",
+ *		has its labels placed within the longer one.  The literals
+ *		are sorted by their bytes reversed, so that the tails of
+ *		a literal directly precede it, and the order depends only
+ *		on the literals themselves.
+ */
 
+static void pool(ostream &ostr)
+{
+    map<string, vector<const Label *>> reversed;
+    vector<const string *> tails;
+    string bytes;
+    size_t start;
 
-    /* Generate the body of this function. */
 
-    _body->generate();
+    for (auto &literal : literals) {
+	bytes = parseString(literal.first);
+	auto &labels = reversed[string(bytes.rbegin(), bytes.rend())];
+	labels.insert(labels.end(), literal.second.begin(), literal.second.end());
+	count(LITERAL_BYTES, bytes.size() + 1);
+    }
 
+    ostr << "\t" << readonly_section << endl;
 
-    /* Generate our epilogue. */
+    for (auto it = reversed.begin(); it != reversed.end(); ++ it) {
+	auto next = it;
 
-    cout << endl << global_prefix << funcname << ".exit:" << endl;
-    cout << "\tmovl\t%ebp, %esp" << endl;
-    cout << "\tpopl\t%ebp" << endl;
-    cout << "\tret" << endl << endl;
+	if (++ next != reversed.end() && next->first.compare(0, it->first.size(), it->first) == 0) {
+	    tails.push_back(&it->first);
+	    count(SHARED_BYTES, it->first.size() + 1);
+	    continue;
+	}
 
-    offset -= align(offset - param_offset);
-    cout << "\t.set\t" << funcname << ".size, " << -offset << endl;
-    cout << "\t.globl\t" << global_prefix << funcname << endl << endl;
-    cerr << "Function::generate done" << endl;
+	bytes.assign(it->first.rbegin(), it->first.rend());
+	tails.push_back(&it->first);
+	start = 0;
+
+	while (!tails.empty()) {
+	    if (bytes.size() - tails.back()->size() > start) {
+		ostr << "\t.ascii\t\"" << escapeString(bytes.substr(start, bytes.size() - tails.back()->size() - start)) << "\"" << endl;
+		start = bytes.size() - tails.back()->size();
+	    }
+
+	    for (auto label : reversed.at(*tails.back()))
+		ostr << *label << ":" << endl;
+
+	    tails.pop_back();
+	}
 
+	ostr << "\t.asciz\t\"" << escapeString(bytes.substr(start)) << "\"" << endl;
+    }
 }
 
 
 /*
  * Function:	generateGlobals
  *
- * Description:	Generate code for any global variable declarations.
+ * Description:	Generate code for any global variable declarations,
+ *		along with the counters of a program being profiled, and
+ *		then the pool of string literals.  This finishes the
+ *		translation unit, so the string literals are then
+ *		forgotten.
  */
 
-void generateGlobals(Scope *scope)
+void generateGlobals(Scope *scope, ostream &ostr)
 {
     const Symbols &symbols = scope->symbols();
 
     for (auto symbol : symbols)
 	if (!symbol->type().isFunction()) {
-	    cout << "\t.comm\t" << global_prefix << symbol->name() << ", ";
-	    cout << symbol->type().size() << endl;
+	    ostr << "\t.comm\t" << global_prefix << symbol->name() << ", ";
+	    ostr << symbol->type().size() << endl;
 	}
-    if(!strings.empty()) {
-        cout << "\t.data" << endl;
-        for (auto it = strings.begin(); it != strings.end(); ++it) {
-            cout << *(it->second) << ":\t.asciz\t\"" << it->first << "\"" << endl;
-        }
-    }
+
+    if (!profile_generate.empty() && numCounters() > 0)
+	profiler(ostr);
+
+    if (!literals.empty())
+	pool(ostr);
+
+    literals.clear();
 }
 
 
@@ -362,12 +1841,14 @@ void Assignment::generate()
     cerr << "Assignment::generate" << endl;
 
     Expression *pointer;
+    stringstream sig;
+    References refs;
 
-    _right->generate();
+    evaluate(_right);
 
     if (_left->isDereference(pointer)) {
 
-        pointer->generate();
+        evaluate(pointer);
         if (pointer->_register == nullptr) {
             load(pointer, getreg());
         }
@@ -376,23 +1857,32 @@ void Assignment::generate()
             load(_right, getreg());
         }
 
-        if (_left->type().size() == 4) {
-            cout << "\tmovl\t" << _right << ", (" << pointer << ")" << endl;
-        } else if (_left->type().size() == 1) {
-            cout << "\tmovb\t" << _right->_register->byte() << ", (" << pointer << ")" << endl;
+        if (_left->type().size() == 1) {
+            out << "\tmovb\t" << _right->_register->byte() << ", (" << pointer << ")" << endl;
+        } else {
+            out << "\tmov" << suffix(_left->type().size()) << "\t" << _right->_register->name(_left->type().size()) << ", (" << pointer << ")" << endl;
         }
         assign(pointer, nullptr);
+        invalidate(nullptr);
 
 
     } else {
         if (_right->_register == nullptr) {
             load(_right, getreg());
         }
-        if (_left->type().size() == 4) {
-            cout << "\tmovl\t" << _right << ", " << _left << endl;
-        } else if (_left->type().size() == 1) {
-            cout << "\tmovb\t" << _right->_register->byte() << ", " << _left << endl;
+        if (_left->type().size() == 1) {
+            out << "\tmovb\t" << _right->_register->byte() << ", " << _left << endl;
+        } else {
+            out << "\tmov" << suffix(_left->type().size()) << "\t" << _right->_register->name(_left->type().size()) << ", " << _left << endl;
         }
+
+        _left->signature(sig, refs);
+
+        for (auto ref : refs)
+            invalidate(ref);
+
+        if (_left->type().size() != SIZEOF_CHAR)
+            remember(_right->_register, _left);
     }
 
     assign(_right, nullptr);
@@ -402,13 +1892,21 @@ void Assignment::generate()
 }
 
 static void compute(Expression *result, Expression *left, Expression *right, const string &opcode){
-    left->generate();
-    right->generate();
+    unsigned size;
+
+    evaluate(left);
+    evaluate(right);
 
     if (left->_register == nullptr) {
         load(left, getreg());
     }
-    cout << "\t" << opcode << "\t" << right << ", " << left << endl;
+
+    size = max(width(left->type()), width(right->type()));
+
+    if (width(left->type()) < size)
+        out << "\tmovslq\t" << left->_register->name(SIZEOF_INT) << ", " << left->_register->name(size) << endl;
+
+    out << "\t" << opcode << suffix(size) << "\t" << right << ", " << left->_register->name(size) << endl;
 
     assign(right, nullptr);
     assign(result, left->_register);
@@ -416,31 +1914,35 @@ static void compute(Expression *result, Expression *left, Expression *right, con
 
 void Add::generate() {
     cerr << "Add::generate" << endl;
-    compute(this, _left, _right, "addl");
+    compute(this, _left, _right, "add");
     cerr << "Add::generate done" << endl;
 
 }
 
 void Subtract::generate() {
     cerr << "Subtract::generate" << endl;
-    compute(this, _left, _right, "subl");
+    compute(this, _left, _right, "sub");
     cerr << "Subtract::generate done" << endl;
 
 }
 
 void Multiply::generate() {
     cerr << "Multiply::generate" << endl;
-    compute(this, _left, _right, "imull");
+    compute(this, _left, _right, "imul");
     cerr << "Multiply::generate done" << endl;
 
 }
 
 void Cast::generate() {
     cerr << "Cast::generate" << endl;
-    _expr->generate();
+    evaluate(_expr);
     if (_expr->_register == nullptr) {
         load(_expr, getreg());
     }
+
+    if (width(_expr->type()) < width(type()))
+        out << "\tmovslq\t" << _expr->_register->name(SIZEOF_INT) << ", " << _expr->_register->name(width(type())) << endl;
+
     assign(this, _expr->_register);
     cerr << "Cast::generate done" << endl;
 
@@ -448,17 +1950,18 @@ void Cast::generate() {
 
 void Divide::generate() {
     cerr << "Divide::generate" << endl;
-    _left->generate();
-    _right->generate();
+    evaluate(_left);
+    evaluate(_right);
 
     load(_left, eax);
 
     load(nullptr, edx);
-    cout << "\tmovl\t%eax, %edx" << endl;
+    forget(edx);
+    out << "\tmovl\t%eax, %edx" << endl;
 
-    cout << "\tsarl\t$31, %edx" << endl;
+    out << "\tsarl\t$31, %edx" << endl;
     load(_right, ecx);
-    cout << "\tidivl\t" << _right << endl;
+    out << "\tidivl\t" << _right << endl;
     load(nullptr, ecx);
 
     assign(this, eax);
@@ -468,120 +1971,151 @@ void Divide::generate() {
 
 void Remainder::generate() {
     cerr << "Remainder::generate" << endl;
-    _left->generate();
-    _right->generate();
+    evaluate(_left);
+    evaluate(_right);
 
     load(_left, eax);
 
     load(nullptr, edx);
-    cout << "\tmovl\t%eax, %edx" << endl;
+    forget(edx);
+    out << "\tmovl\t%eax, %edx" << endl;
 
-    cout << "\tsarl\t$31, %edx" << endl;
+    out << "\tsarl\t$31, %edx" << endl;
     load(_right, ecx);
-    cout << "\tidivl\t" << _right << endl;
+    out << "\tidivl\t" << _right << endl;
     load(nullptr, ecx);
     load(nullptr, eax);
+    forget(eax);
 
     assign(this, edx);
     cerr << "Remainder::generate done" << endl;
 
 }
 
-void Equal::generate() {
-    cerr << "Equal::generate" << endl;
-    _left->generate();
-    _right->generate();
+/*
+ * Function:	compare (private)
+ *
+ * Description:	Generate code to compare two expressions, leaving one in
+ *		the register of the result if the comparison holds and zero
+ *		otherwise.
+ */
+
+static void compare(Expression *result, Expression *left, Expression *right, const string &opcode)
+{
+    unsigned size;
+
+    evaluate(left);
+    evaluate(right);
+
+    load(left, getreg());
+    size = width(left->type());
+    out << "\tcmp" << suffix(size) << "\t" << right << ", " << left << endl;
+    out << "\t" << opcode << "\t" << left->_register->byte() << endl;
+    out << "\tmovzbl\t" << left->_register->byte() << ", " << left->_register->name(SIZEOF_INT) << endl;
+
+    assign(right, nullptr);
+    assign(result, left->_register);
+}
+
+/*
+ * Function:	branch (private)
+ *
+ * Description:	Generate code for a comparison that branches to the given
+ *		label using the given conditional branch, rather than
+ *		computing the value of the comparison to be tested.
+ */
+
+static void branch(Expression *expr, Expression *left, Expression *right, const string &opcode, const Label &label, bool ifTrue)
+{
+    if (!threading()) {
+	expr->Expression::test(label, ifTrue);
+	return;
+    }
 
-    load(_left, getreg());
-    cout << "\tcmpl\t" << _right << ", " << _left << endl;
-    cout << "\tsete\t" << _left->_register->byte() << endl;
-    cout << "\tmovzbl\t" << _left->_register->byte() << ", " << _left->_register << endl;
+    evaluate(left);
+    evaluate(right);
 
-    assign(this, _left->_register);
+    if (left->_register == nullptr)
+	load(left, getreg());
+
+    out << "\tcmp" << suffix(width(left->type())) << "\t" << right << ", " << left << endl;
+    out << "\t" << opcode << "\t" << label << endl;
+
+    assign(left, nullptr);
+    assign(right, nullptr);
+}
+
+void Equal::generate() {
+    cerr << "Equal::generate" << endl;
+    compare(this, _left, _right, "sete");
     cerr << "Equal::generate done" << endl;
 
 }
 
 void NotEqual::generate() {
     cerr << "NotEqual::generate" << endl;
-    _left->generate();
-    _right->generate();
-
-    load(_left, getreg());
-    cout << "\tcmpl\t" << _right << ", " << _left << endl;
-    cout << "\tsetne\t" << _left->_register->byte() << endl;
-    cout << "\tmovzbl\t" << _left->_register->byte() << ", " << _left->_register << endl;
-
-    assign(this, _left->_register);
+    compare(this, _left, _right, "setne");
     cerr << "NotEqual::generate done" << endl;
 
 }
 
 void LessOrEqual::generate() {
     cerr << "LessOrEqual::generate" << endl;
-    _left->generate();
-    _right->generate();
-
-    load(_left, getreg());
-    cout << "\tcmpl\t" << _right << ", " << _left << endl;
-    cout << "\tsetle\t" << _left->_register->byte() << endl;
-    cout << "\tmovzbl\t" << _left->_register->byte() << ", " << _left->_register << endl;
-
-    assign(this, _left->_register);
+    compare(this, _left, _right, "setle");
     cerr << "LessOrEqual::generate done" << endl;
 
 }
 
 void GreaterOrEqual::generate() {
     cerr << "GreaterOrEqual::generate" << endl;
-    _left->generate();
-    _right->generate();
-
-    load(_left, getreg());
-    cout << "\tcmpl\t" << _right << ", " << _left << endl;
-    cout << "\tsetge\t" << _left->_register->byte() << endl;
-    cout << "\tmovzbl\t" << _left->_register->byte() << ", " << _left->_register << endl;
-
-    assign(this, _left->_register);
+    compare(this, _left, _right, "setge");
     cerr << "GreaterOrEqual::generate done" << endl;
 
 }
 
 void LessThan::generate() {
     cerr << "LessThan::generate" << endl;
-    _left->generate();
-    _right->generate();
-
-    load(_left, getreg());
-    cout << "\tcmpl\t" << _right << ", " << _left << endl;
-    cout << "\tsetl\t" << _left->_register->byte() << endl;
-    cout << "\tmovzbl\t" << _left->_register->byte() << ", " << _left->_register << endl;
-
-    assign(this, _left->_register);
+    compare(this, _left, _right, "setl");
     cerr << "LessThan::generate done" << endl;
 
 }
 
 void GreaterThan::generate() {
     cerr << "GreaterThan::generate" << endl;
-    _left->generate();
-    _right->generate();
+    compare(this, _left, _right, "setg");
+    cerr << "GreaterThan::generate done" << endl;
 
-    load(_left, getreg());
-    cout << "\tcmpl\t" << _right << ", " << _left << endl;
-    cout << "\tsetg\t" << _left->_register->byte() << endl;
-    cout << "\tmovzbl\t" << _left->_register->byte() << ", " << _left->_register << endl;
+}
 
-    assign(this, _left->_register);
-    cerr << "GreaterThan::generate done" << endl;
+void Equal::test(const Label &label, bool ifTrue) {
+    branch(this, _left, _right, ifTrue ? "je" : "jne", label, ifTrue);
+}
+
+void NotEqual::test(const Label &label, bool ifTrue) {
+    branch(this, _left, _right, ifTrue ? "jne" : "je", label, ifTrue);
+}
+
+void LessOrEqual::test(const Label &label, bool ifTrue) {
+    branch(this, _left, _right, ifTrue ? "jle" : "jg", label, ifTrue);
+}
+
+void GreaterOrEqual::test(const Label &label, bool ifTrue) {
+    branch(this, _left, _right, ifTrue ? "jge" : "jl", label, ifTrue);
+}
+
+void LessThan::test(const Label &label, bool ifTrue) {
+    branch(this, _left, _right, ifTrue ? "jl" : "jge", label, ifTrue);
+}
 
+void GreaterThan::test(const Label &label, bool ifTrue) {
+    branch(this, _left, _right, ifTrue ? "jg" : "jle", label, ifTrue);
 }
 
 void Negate::generate() {
     cerr << "Negate::generate" << endl;
-    _expr->generate();
+    evaluate(_expr);
     load(_expr, getreg());
-    cout << "\tnegl\t" << _expr << endl;
+    out << "\tnegl\t" << _expr << endl;
     assign(this, _expr->_register);
     cerr << "Negate::generate done" << endl;
 
@@ -589,21 +2123,28 @@ void Negate::generate() {
 
 void Not::generate() {
     cerr << "Not::generate" << endl;
-    _expr->generate();
+    evaluate(_expr);
     load(_expr, getreg());
-    cout << "\tcmpl\t$0, " << _expr << endl;
-    cout << "\tsete\t" << _expr->_register->byte() << endl;
-    cout << "\tmovzbl\t" << _expr->_register->byte() << ", " << _expr << endl;
+    out << "\tcmp" << suffix(width(_expr->type())) << "\t$0, " << _expr << endl;
+    out << "\tsete\t" << _expr->_register->byte() << endl;
+    out << "\tmovzbl\t" << _expr->_register->byte() << ", " << _expr->_register->name(SIZEOF_INT) << endl;
     assign(this, _expr->_register);
     cerr << "Not::generate done" << endl;
 
 }
 
+void Not::test(const Label &label, bool ifTrue) {
+    if (threading())
+	_expr->test(label, !ifTrue);
+    else
+	Expression::test(label, ifTrue);
+}
+
 void Address::generate() {
     cerr << "Address::generate" << endl;
     Expression *pointer;
     if (_expr->isDereference(pointer)) {
-        pointer->generate();
+        evaluate(pointer);
 
         if (pointer->_register == nullptr) {
             load(pointer, getreg());
@@ -611,7 +2152,7 @@ void Address::generate() {
         assign(this, pointer->_register);
     } else {
         assign(this, getreg());
-        cout << "\tleal\t" << _expr << ", " << this << endl;
+        out << "\tlea" << suffix(SIZEOF_PTR) << "\t" << _expr << ", " << this << endl;
     }
     cerr << "Address::generate done" << endl;
 
@@ -620,16 +2161,16 @@ void Address::generate() {
 void Dereference::generate() {
     cerr << "Dereference::generate" << endl;
 
-    _expr->generate();
+    evaluate(_expr);
 
     if(_expr->_register == nullptr) {
         load(_expr, getreg());
     }
 
-    if (_expr->type().deref().size() == 4) {
-        cout << "\tmovl\t(" << _expr << "), " << _expr << endl;
-    } else if (_expr->type().deref().size() == 1) {
-        cout << "\tmovsbl\t(" << _expr << "), " << _expr << endl;
+    if (_expr->type().deref().size() == 1) {
+        out << "\tmovsbl\t(" << _expr << "), " << _expr->_register->name(SIZEOF_INT) << endl;
+    } else {
+        out << "\tmov" << suffix(_expr->type().deref().size()) << "\t(" << _expr << "), " << _expr->_register->name(_expr->type().deref().size()) << endl;
     }
     assign(this, _expr->_register);
     cerr << "Dereference::generate done" << endl;
@@ -638,26 +2179,48 @@ void Dereference::generate() {
 
 void Return::generate() {
     cerr << "Retrun::generate" << endl;
-    _expr->generate();
+
+    if (tailcall(_expr)) {
+	cerr << "Retrun::generate done" << endl;
+	return;
+    }
+
+    evaluate(_expr);
     if (_expr->_register != eax) {
         load(_expr, eax);
     }
-    cout << "\tjmp\t" << funcname << ".exit" << endl;
+
+    if (retlabel != nullptr)
+        out << "\tjmp\t" << *retlabel << endl;
+    else
+        out << "\tjmp\t" << funcname << ".exit" << endl;
+
     assign(_expr, nullptr);
     cerr << "Retrun::generate done" << endl;
 
 }
 
+/*
+ * Function:	Expression::test
+ *
+ * Description:	Generate code to branch to the given label if the value
+ *		of this expression is nonzero, or, if ifTrue is false, if
+ *		it is zero.  When optimizing, a value in memory is tested
+ *		where it is, and only a constant need be loaded.
+ */
+
 void Expression::test(const Label &label, bool ifTrue) {
     cerr << "Expression::test" << endl;
-    generate();
+    unsigned value;
+
+    evaluate(this);
 
-    if (_register == nullptr) {
+    if (_register == nullptr && (!threading() || isNumber(value))) {
         load(this, getreg());
     }
 
-    cout << "\tcmpl\t$0, " << this << endl;
-    cout << (ifTrue ? "\tjne\t" : "\tje\t") << label << endl;
+    out << "\tcmp" << suffix(type().size()) << "\t$0, " << this << endl;
+    out << (ifTrue ? "\tjne\t" : "\tje\t") << label << endl;
 
     assign(this, nullptr);
     cerr << "Expression::test done" << endl;
@@ -672,12 +2235,12 @@ void LogicalOr::generate() {
     _left->test(truelabel, true);
 
     _right->test(truelabel, true);
-    cout << "\tjmp\t" << exitlabel << endl;
+    out << "\tjmp\t" << exitlabel << endl;
     assign(this, getreg());
 
-    cout << truelabel << ":" << endl;
-    cout << "\tmovl\t$1, " << this << endl;
-    cout << exitlabel << ":" << endl;
+    place(truelabel);
+    out << "\tmovl\t$1, " << this << endl;
+    place(exitlabel);
     cerr << "LogicalOr::generate done" << endl;
 
 }
@@ -689,69 +2252,291 @@ void LogicalAnd::generate() {
     _left->test(falselabel, false);
 
     _right->test(falselabel, false);
-    cout << "\tjmp\t" << exitlabel << endl;
+    out << "\tjmp\t" << exitlabel << endl;
     assign(this, getreg());
 
-    cout << falselabel << ":" << endl;
-    cout << "\tmovl\t$0, " << this << endl;
-    cout << exitlabel << ":" << endl;
+    place(falselabel);
+    out << "\tmovl\t$0, " << this << endl;
+    place(exitlabel);
     cerr << "LogicalAnd::generate done" << endl;
 
 }
 
+
+/*
+ * Function:	LogicalOr::test
+ *
+ * Description:	Generate code to branch on a logical-or expression.  Each
+ *		operand is tested in turn and branches straight to where
+ *		control goes once the result is known, so no value is
+ *		computed, which saves a jump and a test of the value.
+ */
+
+void LogicalOr::test(const Label &label, bool ifTrue) {
+    if (!threading()) {
+	Expression::test(label, ifTrue);
+	return;
+    }
+
+    if (ifTrue) {
+	_left->test(label, true);
+	_right->test(label, true);
+    } else {
+	Label skiplabel;
+
+	_left->test(skiplabel, true);
+	_right->test(label, false);
+	place(skiplabel);
+    }
+
+    threaded += 2;
+}
+
+
+/*
+ * Function:	LogicalAnd::test
+ *
+ * Description:	Generate code to branch on a logical-and expression in
+ *		the same way as for a logical-or expression.
+ */
+
+void LogicalAnd::test(const Label &label, bool ifTrue) {
+    if (!threading()) {
+	Expression::test(label, ifTrue);
+	return;
+    }
+
+    if (ifTrue) {
+	Label skiplabel;
+
+	_left->test(skiplabel, false);
+	_right->test(label, true);
+	place(skiplabel);
+    } else {
+	_left->test(label, false);
+	_right->test(label, false);
+    }
+
+    threaded += 2;
+}
+
+
+/*
+ * Function:	rotate (private)
+ *
+ * Description:	Return whether a loop with the given test should be
+ *		rotated, so that the test is at the bottom and is a single
+ *		branch back to the top, taken on every iteration but the
+ *		last.  The loop is entered by jumping to the test.  A loop
+ *		with a constant test never exits, so it has no test at all.
+ */
+
+static bool rotate(Expression *expr)
+{
+    unsigned value;
+
+    return optimize > 0 && reorder_blocks && !expr->isNumber(value);
+}
+
+
+/*
+ * Function:	While::generate
+ *
+ * Description:	Generate code for a while statement.
+ */
+
 void While::generate() {
     cerr << "While::generate" << endl;
 
     Label looplabel, exitlabel;
+    unsigned value;
+    unsigned long saved = weight;
+
+    increment(_counter);
+    weight = frequency(_counter + 1);
+
+    if (rotate(_expr)) {
+        Label testlabel;
+
+        out << "\tjmp\t" << testlabel << endl;
+        place(looplabel);
+        increment(_counter + 1);
+        _stmt->generate();
+        place(testlabel);
+        _expr->test(looplabel, true);
+
+    } else {
+        place(looplabel);
+
+        if (optimize == 0 || !_expr->isNumber(value))
+            _expr->test(exitlabel, false);
 
-    cout << looplabel << ":" << endl;
+        increment(_counter + 1);
+        _stmt->generate();
 
-    _expr->test(exitlabel, false);
-    _stmt->generate();
+        out << "\tjmp\t" << looplabel << endl;
+        place(exitlabel);
+    }
 
-    cout << "\tjmp\t" << looplabel << endl;
-    cout << exitlabel << ":" << endl;
+    weight = saved;
     cerr << "While::generate done" << endl;
 
 }
 
+
+/*
+ * Function:	If::generate
+ *
+ * Description:	Generate code for an if statement.  If the then part is
+ *		cold, the test is inverted so that the else part falls
+ *		through, or, if there is none, the then part is moved out
+ *		of line after the rest of the function and jumps back when
+ *		done, unless it returns.  Code that follows the statement
+ *		then still knows what the registers held after the test,
+ *		unless the then part jumps back.  The then part is cold if the
+ *		profile shows it is run less often than not, or, without a
+ *		count, if it returns and the else part does not, since an
+ *		early return usually handles a special case.  A then part
+ *		moved out of line that jumps back takes two branches each
+ *		time it is run, rather than one each time it is not, so it
+ *		is moved only if run less than a third of the time.
+ */
+
 void If::generate() {
     cerr << "If::generate" << endl;
 
     Label skiplabel, exitlabel;
+    unsigned long total, taken, saved;
+    vector<Register> held;
+    string text;
+    bool invert;
+
+    total = frequency(_counter);
+    taken = frequency(_counter + 1);
+    saved = weight;
+    increment(_counter);
+
+    if (!reorder_blocks)
+        invert = false;
+    else if (total > 0 && (_elseStmt == nullptr && !_thenStmt->returns()))
+        invert = 2 * taken < total - taken;
+    else if (total > 0)
+        invert = taken < total - taken;
+    else
+        invert = optimize > 0 && _thenStmt->returns()
+            && (_elseStmt == nullptr || !_elseStmt->returns());
+
+    if (threading())
+        _expr->test(skiplabel, invert);
+    else {
+        evaluate(_expr);
+        out << "\tcmp" << suffix(_expr->type().size()) << "\t$0, " << _expr << endl;
+        out << (invert ? "\tjne\t" : "\tje\t") << skiplabel << endl;
+        assign(_expr, nullptr);
+    }
 
-    _expr->generate();
-    cout << "\tcmp\t$0, " << _expr << endl;
-    cout << "\tje\t" << skiplabel << endl;
-    assign(_expr, nullptr);
+    if (!invert) {
+        increment(_counter + 1);
+        weight = taken;
+        _thenStmt->generate();
+
+        if (_elseStmt == nullptr) {
+            place(skiplabel);
+        } else {
+            out << "\tjmp\t" << exitlabel << endl;
+            place(skiplabel);
+            weight = total - taken;
+            _elseStmt->generate();
+            place(exitlabel);
+        }
 
-    _thenStmt->generate();
+    } else if (_elseStmt != nullptr) {
+        weight = total - taken;
+        _elseStmt->generate();
+        out << "\tjmp\t" << exitlabel << endl;
+        place(skiplabel);
+        increment(_counter + 1);
+        weight = taken;
+        _thenStmt->generate();
+        place(exitlabel);
 
-    if (_elseStmt == nullptr) {
-        cout << skiplabel << ":" << endl;
     } else {
-        cout << "\tjmp\t" << exitlabel << endl;
-        cout << skiplabel << ":" << endl;
-        _elseStmt->generate();
-        cout << exitlabel << ":" << endl;
+        if (!_thenStmt->returns())
+            place(exitlabel);
+
+        for (auto reg : registers)
+            held.push_back(*reg);
+
+        text = out.str();
+        out.str("");
+
+        place(skiplabel);
+        increment(_counter + 1);
+        weight = taken;
+        _thenStmt->generate();
+
+        if (!_thenStmt->returns())
+            out << "\tjmp\t" << exitlabel << endl;
+
+        cold << out.str();
+        out.str(text);
+        out.seekp(0, ios::end);
+
+        for (unsigned i = 0; i < registers.size(); i ++) {
+            registers[i]->_value = held[i]._value;
+            registers[i]->_refs = held[i]._refs;
+        }
     }
+
+    weight = saved;
     cerr << "If::generate done" << endl;
 
 }
 
+
+/*
+ * Function:	For::generate
+ *
+ * Description:	Generate code for a for statement, which is rotated in
+ *		the same way as a while statement.
+ */
+
 void For::generate() {
     cerr << "For::generate" << endl;
     Label looplabel, exitlabel;
+    unsigned value;
+    unsigned long saved = weight;
 
     _init->generate();
 
-    cout << looplabel << ":" << endl;
+    increment(_counter);
+    weight = frequency(_counter + 1);
+
+    if (rotate(_expr)) {
+        Label testlabel;
+
+        out << "\tjmp\t" << testlabel << endl;
+        place(looplabel);
+        increment(_counter + 1);
+        _stmt->generate();
+        _incr->generate();
+        place(testlabel);
+        _expr->test(looplabel, true);
+
+    } else {
+        place(looplabel);
+
+        if (optimize == 0 || !_expr->isNumber(value))
+            _expr->test(exitlabel, false);
+
+        increment(_counter + 1);
+        _stmt->generate();
+        _incr->generate();
+        out << "\tjmp\t" << looplabel << endl;
+        place(exitlabel);
+    }
 
-    _expr->test(exitlabel, false);
-    _stmt->generate();
-    _incr->generate();
-    cout << "\tjmp\t" << looplabel << endl;
-    cout << exitlabel << ":" << endl;
+    weight = saved;
     cerr << "For::generate done" << endl;
 
 }
@@ -9,7 +9,9 @@
 # ifndef GENERATOR_H
 # define GENERATOR_H
 # include "Scope.h"
+# include "Tree.h"
 
-void generateGlobals(Scope *scope);
+void generateFunctions(const Functions &functions, const Scope *globals, unsigned threads, std::ostream &ostr);
+void generateGlobals(Scope *scope, std::ostream &ostr);
 
 # endif /* GENERATOR_H */
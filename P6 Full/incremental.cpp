@@ -0,0 +1,472 @@
+/*
+ * File:	incremental.cpp
+ *
+ * Description:	This file contains the public and private function
+ *		definitions for recompiling only the functions changed
+ *		since the previous compilation, which is recorded in a
+ *		snapshot file.
+ *
+ *		The source text is first split into its top-level
+ *		definitions without being parsed.  Each function depends
+ *		on the global names it mentions that were declared before
+ *		it, which is conservative, as a local variable may hide a
+ *		global.  A function must be compiled again if its text
+ *		changed, if it depends on different names than before, or
+ *		if any name it depends on was changed, added, or removed.
+ *		Otherwise, its code is taken from the snapshot.
+ *
+ *		The source is then rewritten so that each function reused
+ *		has an empty body, keeping its line breaks so that line
+ *		numbers are unchanged, and the rewritten source is parsed
+ *		as usual.  Since calls to small functions may be inlined
+ *		when optimizing, a function calling one that must be
+ *		compiled again must be compiled again too, and any
+ *		function called by a function being compiled again keeps
+ *		its body, although its code is still reused.
+ */
+
+# include <set>
+# include <algorithm>
+# include <map>
+# include <mutex>
+# include <vector>
+# include <cctype>
+# include <fstream>
+# include <iostream>
+# include "incremental.h"
+# include "options.h"
+# include "lexer.h"
+
+using namespace std;
+
+struct Definition {
+    string text, name;
+    size_t body;
+    set<string> words, deps;
+};
+
+struct Compiled {
+    string text, code;
+    set<string> deps;
+    map<string, unsigned> strings;
+};
+
+static const string magic = "scc-snapshot 1";
+
+static vector<Definition> definitions;
+static map<string, Compiled> previous, current;
+static set<string> reusable;
+static mutex recording;
+
+
+/*
+ * Function:	skip (private)
+ *
+ * Description:	Return the position following a comment or string literal
+ *		starting at the given position, or the position itself if
+ *		there is none there.
+ */
+
+static size_t skip(const string &text, size_t i)
+{
+    size_t end;
+
+
+    if (text.compare(i, 2, "/*") == 0) {
+	end = text.find("*/", i + 2);
+	return end == string::npos ? text.size() : end + 2;
+    }
+
+    if (text[i] == '"') {
+	for (i ++; i < text.size() && text[i] != '"' && text[i] != '\n'; i ++)
+	    if (text[i] == '\\')
+		i ++;
+
+	return i + 1;
+    }
+
+    return i;
+}
+
+
+/*
+ * Function:	analyze (private)
+ *
+ * Description:	Find the words mentioned in a definition, other than
+ *		keywords, and the name of the function if it is one, which
+ *		is the first word of its header.
+ */
+
+static void analyze(Definition &def)
+{
+    const string &text = def.text;
+    size_t i = 0, next;
+    string word;
+
+
+    while (i < text.size()) {
+	if ((next = skip(text, i)) != i)
+	    i = next;
+
+	else if (isalpha(text[i]) || text[i] == '_') {
+	    word.clear();
+
+	    while (i < text.size() && (isalnum(text[i]) || text[i] == '_'))
+		word += text[i ++];
+
+	    if (!isKeyword(word)) {
+		if (def.body != string::npos && def.name.empty() && i < def.body)
+		    def.name = word;
+
+		def.words.insert(word);
+	    }
+
+	} else
+	    i ++;
+    }
+}
+
+
+/*
+ * Function:	split (private)
+ *
+ * Description:	Split the source text into its top-level definitions.  A
+ *		declaration ends with a semicolon and a function with the
+ *		brace closing its body.  Any text between definitions is
+ *		included with the definition following it.
+ */
+
+static vector<Definition> split(const string &source)
+{
+    vector<Definition> defs;
+    Definition def;
+    unsigned depth = 0;
+    size_t start = 0, i = 0, next;
+    bool done;
+
+
+    def.body = string::npos;
+
+    while (i < source.size()) {
+	if ((next = skip(source, i)) != i) {
+	    i = next;
+	    continue;
+	}
+
+	done = false;
+
+	if (source[i] == '{') {
+	    if (depth ++ == 0 && def.body == string::npos)
+		def.body = i - start;
+	} else if (source[i] == '}' && depth > 0)
+	    done = -- depth == 0 && def.body != string::npos;
+	else if (source[i] == ';')
+	    done = depth == 0;
+
+	i ++;
+
+	if (done || i == source.size()) {
+	    def.text = source.substr(start, i - start);
+	    analyze(def);
+	    defs.push_back(def);
+
+	    def = Definition();
+	    def.body = string::npos;
+	    start = i;
+	}
+    }
+
+    return defs;
+}
+
+
+/*
+ * Functions:	put, get (private)
+ *
+ * Description:	Write and read a string to and from a snapshot, preceded
+ *		by its length.
+ */
+
+static void put(ostream &ostr, const string &s)
+{
+    ostr << s.size() << endl << s << endl;
+}
+
+static bool get(istream &istr, string &s)
+{
+    size_t length;
+
+    if (!(istr >> length) || istr.get() != '\n')
+	return false;
+
+    s.resize(length);
+    return istr.read(&s[0], length) && istr.get() == '\n';
+}
+
+
+/*
+ * Function:	load (private)
+ *
+ * Description:	Read the previous compilation from the snapshot, which is
+ *		ignored if it is missing or was compiled with different
+ *		options.  The declarations are given back as a multiset of
+ *		their texts.
+ */
+
+static void load(multiset<string> &decls)
+{
+    ifstream file(snapshot);
+    string line, kind, name, text, dep;
+    unsigned count, number;
+    Compiled compiled;
+
+
+    previous.clear();
+
+    if (!getline(file, line) || line != magic)
+	return;
+
+    if (!getline(file, line) || line != codegenOptions())
+	return;
+
+    while (file >> kind && file.get() == '\n') {
+	if (kind == "declaration" && get(file, text))
+	    decls.insert(text);
+
+	else if (kind == "function" && get(file, name)) {
+	    compiled = Compiled();
+
+	    if (!get(file, compiled.text) || !get(file, compiled.code) || !(file >> count))
+		break;
+
+	    for (unsigned i = 0; i < count && get(file, dep); i ++)
+		compiled.deps.insert(dep);
+
+	    if (!(file >> count))
+		break;
+
+	    for (unsigned i = 0; i < count && file >> number && get(file, text); i ++)
+		compiled.strings[text] = number;
+
+	    previous[name] = compiled;
+	} else
+	    break;
+    }
+}
+
+
+/*
+ * Function:	prepare
+ *
+ * Description:	Decide which functions in the source text need to be
+ *		compiled again and return the rewritten source text.
+ */
+
+string prepare(const string &source)
+{
+    set<string> changed, declared, needed, dirty, defined;
+    multiset<string> decls;
+    string result;
+    unsigned count = 0;
+    bool found;
+
+
+    definitions = split(source);
+    current.clear();
+    reusable.clear();
+    load(decls);
+
+
+    /* Find the names whose definitions have changed or are gone. */
+
+    for (auto &def : definitions)
+	if (def.body != string::npos)
+	    defined.insert(def.name);
+
+    for (auto &entry : previous)
+	if (defined.count(entry.first) == 0)
+	    changed.insert(entry.first);
+
+    for (auto &def : definitions) {
+	if (def.body != string::npos) {
+	    if (previous.count(def.name) == 0 || previous[def.name].text != def.text)
+		changed.insert(def.name);
+
+	} else if (decls.count(def.text) > 0)
+	    decls.erase(decls.find(def.text));
+
+	else
+	    changed.insert(def.words.begin(), def.words.end());
+    }
+
+    for (auto &text : decls) {
+	Definition def;
+
+	def.text = text;
+	def.body = string::npos;
+	analyze(def);
+	changed.insert(def.words.begin(), def.words.end());
+    }
+
+
+    /* Find the functions that are dirty and those they call.  When
+       optimizing, a function may contain the inlined code of those it
+       calls, so it is dirty if any of them is. */
+
+    for (auto &def : definitions) {
+	if (def.body != string::npos)
+	    declared.insert(def.name);
+
+	for (auto &word : def.words)
+	    if (declared.count(word) > 0)
+		def.deps.insert(word);
+
+	if (def.body == string::npos)
+	    declared.insert(def.words.begin(), def.words.end());
+
+	else if (changed.count(def.name) > 0 || previous[def.name].deps != def.deps)
+	    dirty.insert(def.name);
+
+	else
+	    for (auto &dep : def.deps)
+		if (changed.count(dep) > 0)
+		    dirty.insert(def.name);
+    }
+
+    do {
+	found = false;
+
+	for (auto &def : definitions)
+	    if (optimize > 0 && def.body != string::npos && dirty.count(def.name) == 0)
+		for (auto &dep : def.deps)
+		    if (dirty.count(dep) > 0) {
+			dirty.insert(def.name);
+			found = true;
+			break;
+		    }
+    } while (found);
+
+    for (auto &def : definitions)
+	if (optimize > 0 && dirty.count(def.name) > 0)
+	    needed.insert(def.deps.begin(), def.deps.end());
+
+
+    /* Rewrite the source, emptying the bodies of functions not needed. */
+
+    for (auto &def : definitions) {
+	if (def.body == string::npos || dirty.count(def.name) > 0)
+	    result += def.text;
+
+	else {
+	    reusable.insert(def.name);
+	    count ++;
+
+	    if (needed.count(def.name) > 0)
+		result += def.text;
+	    else {
+		result += def.text.substr(0, def.body) + "{";
+		result += string(std::count(def.text.begin() + def.body, def.text.end(), '\n'), '\n');
+		result += "}";
+	    }
+	}
+    }
+
+    if (opt_report) {
+	*diagnostics << "incremental: " << count << " of " << count + dirty.size();
+	*diagnostics << " functions reused" << endl;
+    }
+
+    return result;
+}
+
+
+/*
+ * Function:	reuse
+ *
+ * Description:	Give the code for a function from the previous compilation
+ *		if it need not be compiled again, returning whether it was
+ *		given.  The labels of its string literals are recreated.
+ */
+
+bool reuse(const Function *function, string &text, Strings &strings)
+{
+    const string &name = function->id()->name();
+
+    if (reusable.count(name) == 0)
+	return false;
+
+    text = previous.at(name).code;
+
+    for (auto &literal : previous.at(name).strings)
+	strings[literal.first] = new Label(name, literal.second);
+
+    return true;
+}
+
+
+/*
+ * Function:	record
+ *
+ * Description:	Record the code generated for a function, which may be
+ *		called from several threads at once.
+ */
+
+void record(const Function *function, const string &text, const Strings &strings)
+{
+    lock_guard<mutex> guard(recording);
+    Compiled &compiled = current[function->id()->name()];
+
+    compiled.code = text;
+
+    for (auto &literal : strings)
+	compiled.strings[literal.first] = literal.second->number();
+}
+
+
+/*
+ * Function:	saveSnapshot
+ *
+ * Description:	Write the snapshot for this compilation, which must have
+ *		succeeded.  The snapshot is written under a temporary name
+ *		and then renamed, so it is never left partly written.
+ */
+
+void saveSnapshot()
+{
+    string temp = snapshot + ".tmp";
+    ofstream file(temp);
+
+
+    file << magic << endl << codegenOptions() << endl;
+
+    for (auto &def : definitions) {
+	if (def.body == string::npos) {
+	    file << "declaration" << endl;
+	    put(file, def.text);
+	    continue;
+	}
+
+	const Compiled &compiled = reusable.count(def.name) > 0 ? previous[def.name] : current[def.name];
+
+	file << "function" << endl;
+	put(file, def.name);
+	put(file, def.text);
+	put(file, compiled.code);
+	file << def.deps.size() << endl;
+
+	for (auto &dep : def.deps)
+	    put(file, dep);
+
+	file << compiled.strings.size() << endl;
+
+	for (auto &literal : compiled.strings) {
+	    file << literal.second << endl;
+	    put(file, literal.first);
+	}
+    }
+
+    file.close();
+
+    if (!file || rename(temp.c_str(), snapshot.c_str()) != 0)
+	remove(temp.c_str());
+}
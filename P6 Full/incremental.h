@@ -0,0 +1,20 @@
+/*
+ * File:	incremental.h
+ *
+ * Description:	This file contains the function declarations for
+ *		recompiling only the functions changed since the previous
+ *		compilation.
+ */
+
+# ifndef INCREMENTAL_H
+# define INCREMENTAL_H
+# include <string>
+# include "cache.h"
+# include "Tree.h"
+
+std::string prepare(const std::string &source);
+bool reuse(const Function *function, std::string &text, Strings &strings);
+void record(const Function *function, const std::string &text, const Strings &strings);
+void saveSnapshot();
+
+# endif /* INCREMENTAL_H */
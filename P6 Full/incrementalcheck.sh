@@ -0,0 +1,71 @@
+#!/bin/sh
+#
+# incrementalcheck.sh - check that -fincremental matches a full compile
+#
+# Each case is a program and an edit to it.  The program is compiled
+# with -fincremental to write a snapshot, then edited and compiled again
+# with the same snapshot, and the code must be the same as that of a
+# full compile of the edited program.  The cases are compiled with the
+# given options, or -O by default, since inlining lets the code of one
+# function depend on the body of another.
+#
+# usage: incrementalcheck.sh [scc options ...]
+#
+
+SCC=./scc
+WORKDIR=${TMPDIR:-/tmp}/scc-incrementalcheck.$$
+OPTIONS=${*:--O}
+
+trap 'rm -rf $WORKDIR' 0
+trap 'exit 1' 1 2 15
+mkdir -p $WORKDIR || exit 1
+
+status=0
+
+
+# Compile the program in $WORKDIR/a.c, apply the given sed expression to
+# it, and compare the incremental and full compiles of the result.
+
+check() {
+    name=$1
+    rm -f $WORKDIR/snapshot
+
+    $SCC $OPTIONS -fincremental=$WORKDIR/snapshot < $WORKDIR/a.c > /dev/null 2>&1
+    sed "$2" $WORKDIR/a.c > $WORKDIR/b.c
+    $SCC $OPTIONS -fincremental=$WORKDIR/snapshot < $WORKDIR/b.c > $WORKDIR/incremental.s 2> /dev/null
+    $SCC $OPTIONS < $WORKDIR/b.c > $WORKDIR/full.s 2> /dev/null
+
+    if cmp -s $WORKDIR/incremental.s $WORKDIR/full.s; then
+	echo "$name: ok"
+    else
+	echo "$name: incremental code differs from a full compile" 1>&2
+	status=1
+    fi
+}
+
+
+# A global changes type, and main has inlined the functions using it.
+
+cat > $WORKDIR/a.c << EOF
+int printf();
+int x;
+void s(void) { x = 300; }
+int g(void) { return x; }
+int main(void) { s(); printf("%d\n", g()); }
+EOF
+
+check inlined 's/^int x;/char x;/'
+
+
+# A function defined after its caller changes.
+
+cat > $WORKDIR/a.c << EOF
+int printf();
+int f(void);
+int main(void) { printf("%d\n", f()); }
+int f(void) { return 1; }
+EOF
+
+check later 's/return 1;/return 2;/'
+
+exit $status
@@ -0,0 +1,498 @@
+/*
+ * File:	inliner.cpp
+ *
+ * Description:	This file contains the public and member function
+ *		definitions for inlining function calls in Simple C.
+ *
+ *		A call is inlined if the function called is defined in the
+ *		same translation unit, is small, and is a leaf function
+ *		(i.e., makes no calls itself, so it cannot be recursive).
+ *		The call is replaced by a copy of the body of the function,
+ *		in which each parameter and local variable is replaced by a
+ *		fresh symbol.  The fresh symbols are declared in the block
+ *		enclosing the call, so they are allocated storage in the
+ *		frame of the caller.
+ *
+ *		Copying a tree is also how we measure the size of a
+ *		function, since we must visit every node anyway.
+ *
+ *		With a profile, a function never called is not inlined,
+ *		since the copies would only make the program larger, and a
+ *		function called often may be larger than usual.
+ */
+
+# include <map>
+# include <iostream>
+# include "inliner.h"
+# include "options.h"
+# include "profile.h"
+# include "timing.h"
+# include "lexer.h"
+
+using namespace std;
+
+static const unsigned max_nodes = 32, max_hot_nodes = 128;
+static const unsigned long hot_calls = 1000;
+
+static thread_local unsigned inlined, cloned, fresh;
+static thread_local bool calls;
+static thread_local Scope *enclosing;
+static thread_local map<const Symbol *, Symbol *> substitutes;
+static thread_local map<string, const Function *> candidates;
+
+
+/*
+ * Function:	copy (private)
+ *
+ * Description:	Count another node as having been cloned and return it.
+ */
+
+template<class T>
+static T *copy(T *node)
+{
+    cloned ++;
+    return node;
+}
+
+
+/*
+ * Function:	substitute (private)
+ *
+ * Description:	Return the substitute for a symbol, which is either the
+ *		fresh symbol created when its declaration was cloned, or the
+ *		symbol itself if it was not declared within the function.
+ */
+
+static const Symbol *substitute(const Symbol *symbol)
+{
+    if (substitutes.count(symbol) > 0)
+	return substitutes[symbol];
+
+    return symbol;
+}
+
+
+/*
+ * From this point on are the member functions for cloning the tree.  A
+ * call is never cloned when inlining, since only leaf functions are
+ * inlined, but we must note that one was seen.
+ */
+
+Expression *String::clone() const
+{
+    return copy(new String(_value));
+}
+
+Expression *Identifier::clone() const
+{
+    return copy(new Identifier(substitute(_symbol)));
+}
+
+Expression *Number::clone() const
+{
+    return copy(new Number(_value));
+}
+
+Expression *Call::clone() const
+{
+    Expressions args;
+
+    for (auto arg : _args)
+	args.push_back(arg->clone());
+
+    calls = true;
+    return copy(new Call(_id, args, _type));
+}
+
+Expression *Inline::clone() const
+{
+    Statements params;
+
+    for (auto param : _params)
+	params.push_back(param->clone());
+
+    calls = true;
+    return copy(new Inline(_id, params, (Block *) _body->clone(), _type));
+}
+
+Expression *Not::clone() const
+{
+    return copy(new Not(_expr->clone(), _type));
+}
+
+Expression *Negate::clone() const
+{
+    return copy(new Negate(_expr->clone(), _type));
+}
+
+Expression *Dereference::clone() const
+{
+    return copy(new Dereference(_expr->clone(), _type));
+}
+
+Expression *Address::clone() const
+{
+    return copy(new Address(_expr->clone(), _type));
+}
+
+Expression *Cast::clone() const
+{
+    return copy(new Cast(_expr->clone(), _type));
+}
+
+Expression *Multiply::clone() const
+{
+    return copy(new Multiply(_left->clone(), _right->clone(), _type));
+}
+
+Expression *Divide::clone() const
+{
+    return copy(new Divide(_left->clone(), _right->clone(), _type));
+}
+
+Expression *Remainder::clone() const
+{
+    return copy(new Remainder(_left->clone(), _right->clone(), _type));
+}
+
+Expression *Add::clone() const
+{
+    return copy(new Add(_left->clone(), _right->clone(), _type));
+}
+
+Expression *Subtract::clone() const
+{
+    return copy(new Subtract(_left->clone(), _right->clone(), _type));
+}
+
+Expression *LessThan::clone() const
+{
+    return copy(new LessThan(_left->clone(), _right->clone(), _type));
+}
+
+Expression *GreaterThan::clone() const
+{
+    return copy(new GreaterThan(_left->clone(), _right->clone(), _type));
+}
+
+Expression *LessOrEqual::clone() const
+{
+    return copy(new LessOrEqual(_left->clone(), _right->clone(), _type));
+}
+
+Expression *GreaterOrEqual::clone() const
+{
+    return copy(new GreaterOrEqual(_left->clone(), _right->clone(), _type));
+}
+
+Expression *Equal::clone() const
+{
+    return copy(new Equal(_left->clone(), _right->clone(), _type));
+}
+
+Expression *NotEqual::clone() const
+{
+    return copy(new NotEqual(_left->clone(), _right->clone(), _type));
+}
+
+Expression *LogicalAnd::clone() const
+{
+    return copy(new LogicalAnd(_left->clone(), _right->clone(), _type));
+}
+
+Expression *LogicalOr::clone() const
+{
+    return copy(new LogicalOr(_left->clone(), _right->clone(), _type));
+}
+
+Statement *Assignment::clone() const
+{
+    return copy(new Assignment(_left->clone(), _right->clone()));
+}
+
+Statement *Return::clone() const
+{
+    return copy(new Return(_expr->clone()));
+}
+
+Statement *While::clone() const
+{
+    return copy(new While(_expr->clone(), _stmt->clone(), _counter));
+}
+
+Statement *For::clone() const
+{
+    Statement *init = _init->clone();
+    Expression *expr = _expr->clone();
+    Statement *incr = _incr->clone();
+
+    return copy(new For(init, expr, incr, _stmt->clone(), _counter));
+}
+
+Statement *If::clone() const
+{
+    Statement *thenStmt = _thenStmt->clone();
+    Statement *elseStmt = nullptr;
+
+    if (_elseStmt != nullptr)
+	elseStmt = _elseStmt->clone();
+
+    return copy(new If(_expr->clone(), thenStmt, elseStmt, _counter));
+}
+
+Statement *Simple::clone() const
+{
+    return copy(new Simple(_expr->clone()));
+}
+
+
+/*
+ * Function:	Block::clone
+ *
+ * Description:	Clone a block.  Each symbol declared in the block is
+ *		replaced by a fresh symbol, which is declared in the
+ *		enclosing scope of the call rather than in the copy.  The
+ *		fresh symbol is given a unique name since it may share the
+ *		scope with other copies.
+ */
+
+Statement *Block::clone() const
+{
+    Statements stmts;
+    Symbol *symbol;
+
+
+    for (auto decl : _decls->symbols()) {
+	symbol = new Symbol(decl->name() + "." + to_string(++ fresh), decl->type());
+	substitutes[decl] = symbol;
+
+	if (enclosing != nullptr)
+	    enclosing->insert(symbol);
+    }
+
+    for (auto stmt : _stmts)
+	stmts.push_back(stmt->clone());
+
+    return copy(new Block(new Scope(), stmts));
+}
+
+
+/*
+ * Function:	Call::expand
+ *
+ * Description:	Expand a function call, replacing it with an inlined copy
+ *		of the function if it is a candidate for inlining and is
+ *		passed as many arguments as it has parameters, which a call
+ *		after an old-style declaration need not be.  From
+ *		this point on are the functions for expanding the calls in
+ *		the rest of the tree, which simply visit each child.
+ */
+
+Expression *Call::expand()
+{
+    for (auto &arg : _args)
+	arg = arg->expand();
+
+    if (candidates.count(_id->name()) > 0 && _args.size() ==
+	    candidates[_id->name()]->id()->type().parameters()->size()) {
+	inlined ++;
+	return candidates[_id->name()]->instantiate(_args, _type);
+    }
+
+    return this;
+}
+
+Expression *Unary::expand()
+{
+    _expr = _expr->expand();
+    return this;
+}
+
+Expression *Binary::expand()
+{
+    _left = _left->expand();
+    _right = _right->expand();
+    return this;
+}
+
+void Assignment::expand()
+{
+    _left = _left->expand();
+    _right = _right->expand();
+}
+
+void Return::expand()
+{
+    _expr = _expr->expand();
+}
+
+void While::expand()
+{
+    _expr = _expr->expand();
+    _stmt->expand();
+}
+
+void For::expand()
+{
+    _init->expand();
+    _expr = _expr->expand();
+    _incr->expand();
+    _stmt->expand();
+}
+
+void If::expand()
+{
+    _expr = _expr->expand();
+    _thenStmt->expand();
+
+    if (_elseStmt != nullptr)
+	_elseStmt->expand();
+}
+
+void Simple::expand()
+{
+    _expr = _expr->expand();
+}
+
+
+/*
+ * Function:	Block::expand
+ *
+ * Description:	Expand the calls in a block.  Any fresh symbols needed
+ *		when inlining are declared in this block.
+ */
+
+void Block::expand()
+{
+    Scope *saved = enclosing;
+
+
+    enclosing = _decls;
+
+    for (auto stmt : _stmts)
+	stmt->expand();
+
+    enclosing = saved;
+}
+
+
+/*
+ * Function:	Function::inlineable
+ *
+ * Description:	Return whether calls to this function may be inlined,
+ *		which we determine by cloning its body, since cloning
+ *		visits the entire tree.
+ */
+
+bool Function::inlineable() const
+{
+    Scope *saved = enclosing;
+    unsigned limit = max_nodes;
+
+
+    if (profiled() && frequency(_counter) == 0)
+	return false;
+
+    if (profiled() && frequency(_counter) >= hot_calls)
+	limit = max_hot_nodes;
+
+    enclosing = nullptr;
+    substitutes.clear();
+    cloned = 0;
+    calls = false;
+
+    _body->clone();
+    enclosing = saved;
+
+    return !calls && cloned <= limit;
+}
+
+
+/*
+ * Function:	Function::instantiate
+ *
+ * Description:	Return an inlined copy of this function called with the
+ *		given arguments.  Each argument is assigned to the fresh
+ *		symbol replacing its parameter.
+ */
+
+Expression *Function::instantiate(const Expressions &args, const Type &type) const
+{
+    const Symbols &symbols = _body->declarations()->symbols();
+    Statements params;
+    Block *body;
+
+
+    substitutes.clear();
+    body = (Block *) _body->clone();
+
+    for (unsigned i = 0; i < args.size(); i ++) {
+	Expression *param = new Identifier(substitutes[symbols[i]]);
+	params.push_back(new Assignment(param, args[i]));
+    }
+
+    return new Inline(_id, params, body, type);
+}
+
+
+/*
+ * Function:	Function::expand
+ *
+ * Description:	Expand the calls in the body of this function.
+ */
+
+void Function::expand()
+{
+    inlined = 0;
+    fresh = 0;
+    _body->expand();
+
+    if (opt_report)
+	*diagnostics << _id->name() << ": " << inlined << " calls inlined" << endl;
+}
+
+
+/*
+ * Function:	inlineCalls
+ *
+ * Description:	Inline the calls to small leaf functions within all the
+ *		functions of a translation unit.  The candidates are all
+ *		chosen before any call is expanded, so an expanded function
+ *		is never itself inlined.
+ */
+
+void inlineCalls(const Functions &functions)
+{
+    PhaseTimer timer(OPTIMIZING);
+
+
+    candidates.clear();
+
+    for (auto function : functions)
+	if (function->inlineable())
+	    candidates[function->id()->name()] = function;
+
+    for (auto function : functions)
+	function->expand();
+}
+
+
+/*
+ * Function:	inlineCalls
+ *
+ * Description:	Inline the calls to small leaf functions within a single
+ *		function, for use when the functions are seen one at a
+ *		time.  Only the functions seen so far are candidates, and
+ *		the function itself then becomes a candidate.
+ */
+
+void inlineCalls(Function *function)
+{
+    PhaseTimer timer(OPTIMIZING);
+
+
+    function->expand();
+
+    if (function->inlineable())
+	candidates[function->id()->name()] = function;
+}
@@ -0,0 +1,17 @@
+/*
+ * File:	inliner.h
+ *
+ * Description:	This file contains the function declarations for inlining
+ *		function calls in Simple C.  Most of the function
+ *		declarations are actually member functions provided as part
+ *		of Tree.h.
+ */
+
+# ifndef INLINER_H
+# define INLINER_H
+# include "Tree.h"
+
+void inlineCalls(const Functions &functions);
+void inlineCalls(Function *function);
+
+# endif /* INLINER_H */
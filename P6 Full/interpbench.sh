@@ -0,0 +1,109 @@
+#!/bin/sh
+#
+# interpbench.sh - measure how long scc --interp takes to run a program
+#
+# Each program in the examples directory is run on its input in two
+# ways, several times each, keeping the fastest run: compiled by scc -m64
+# to assembly, assembled and linked with gcc, and run, and encoded by
+# scc --interp as bytecode and interpreted at once.  The outputs of the
+# two must match, and the total of each column is given last.  A loop
+# generated here is then interpreted to give the number of bytecode
+# instructions dispatched per second.  The table is also written to
+# interpbench.log.
+#
+# usage: interpbench.sh [program ...]
+#
+
+SCC=./scc
+DIR=examples
+LOG=interpbench.log
+RUNS=${RUNS:-5}
+WORKDIR=${TMPDIR:-/tmp}/scc-interpbench.$$
+
+trap 'rm -rf $WORKDIR' 0
+trap 'exit 1' 1 2 15
+mkdir -p $WORKDIR || exit 1
+
+programs=${*:-`cd $DIR && ls *.c | sed 's/\.c$//'`}
+
+
+# Run the given command several times with the input of the given
+# program, printing the time of the fastest run in milliseconds.  The
+# output of every run is kept in $WORKDIR/output.
+
+measure() {
+    program=$1
+    shift
+    best=
+    run=0
+
+    while [ $run -lt $RUNS ]; do
+	start=`date +%s%N`
+	sh -c "$*" < $DIR/$program.in > $WORKDIR/output 2> /dev/null
+	stop=`date +%s%N`
+	time=`expr \( $stop - $start \) / 1000000`
+
+	if [ -z "$best" ] || [ $time -lt $best ]; then
+	    best=$time
+	fi
+
+	run=`expr $run + 1`
+    done
+
+    echo $best
+}
+
+
+printf "%-8s %12s %12s %8s\n" program "scc+gcc ms" "--interp ms" speedup | tee $LOG
+
+for program in $programs; do
+    pipeline="$SCC -m64 < $DIR/$program.c > $WORKDIR/a.s &&
+	gcc -o $WORKDIR/a.out $WORKDIR/a.s && $WORKDIR/a.out"
+
+    if $SCC -m64 < $DIR/$program.c 2> /dev/null > $WORKDIR/a.s &&
+	gcc -o $WORKDIR/a.out $WORKDIR/a.s 2> /dev/null; then
+	reference=`measure $program "$pipeline"`
+	cp $WORKDIR/output $WORKDIR/expected
+    else
+	echo "$program: scc -m64+gcc failed" 1>&2
+	reference=-
+    fi
+
+    time=`measure $program "$SCC --interp $DIR/$program.c"`
+
+    if [ $reference != - ] && ! cmp -s $WORKDIR/output $WORKDIR/expected; then
+	echo "$program: scc --interp output differs from scc+gcc" 1>&2
+	continue
+    fi
+
+    speedup=`echo $reference $time | awk '{ printf "%s", ($1 == "-" || $2 == 0 ? "-" : sprintf("%.1f", $1 / $2)) }'`
+    printf "%-8s %12s %12s %8s\n" $program $reference $time $speedup
+done | awk '
+    { print }
+    $2 != "-" { reference += $2; time += $3 }
+    END { printf "%-8s %12d %12d %8s\n", "total", reference, time,
+	    (time > 0 ? sprintf("%.1f", reference / time) : "-") }
+' | tee -a $LOG
+
+
+# Interpret a loop long enough that the time to encode it is lost in
+# the time to run it, and report the dispatch rate.
+
+cat > $WORKDIR/loop.c << EOF
+int main(void)
+{
+    int i, sum;
+
+    i = 0;
+    sum = 0;
+
+    while (i < 10000000) {
+	sum = sum + i % 7;
+	i = i + 1;
+    }
+
+    return sum - sum;
+}
+EOF
+
+$SCC --interp -ftime-report $WORKDIR/loop.c 2>&1 | grep interpreted | tee -a $LOG
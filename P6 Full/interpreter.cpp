@@ -0,0 +1,983 @@
+/*
+ * File:	interpreter.cpp
+ *
+ * Description:	This file contains the public and member function
+ *		definitions for encoding a program as bytecode and
+ *		interpreting it, so that it may be run without being
+ *		assembled or linked at all.
+ *
+ *		The bytecode is for a stack machine: each expression
+ *		pushes its value on a stack of words, and each statement
+ *		leaves the stack as it found it.  Each function has a frame
+ *		of its own holding its parameters, one to a word, and then
+ *		its local variables.  The first word of a frame is unused,
+ *		so that no local variable has an offset of zero, which
+ *		denotes a global.  A few superinstructions read and write
+ *		local variables directly.  The program has the data layout
+ *		of the host, since its pointers are those of the host, so
+ *		the functions of the C library are simply called with the
+ *		first several words on the stack as their arguments.
+ *
+ *		Before the program is run, each opcode is replaced by the
+ *		address of the code that executes it, and each jump target
+ *		by its address, so that dispatching an instruction is a
+ *		single indirect jump.  This relies upon the labels as values
+ *		extension of GCC.
+ */
+
+# include <map>
+# include <memory>
+# include <chrono>
+# include <cstdio>
+# include <cstdint>
+# include <cstdlib>
+# include <iostream>
+# include <dlfcn.h>
+# include "interpreter.h"
+# include "options.h"
+# include "machine.h"
+# include "string.h"
+# include "timing.h"
+
+using namespace std;
+
+enum Opcode {
+    HALT, PUSH, LOCAL, LOADC, LOADI, LOADP, LOCALC, LOCALI, LOCALP,
+    STOREC, STOREI, STOREP, SETC, SETI, SETP, ADD, ADDP, SUB, SUBP, MUL,
+    DIV, REM, NEG, NOT, EQ, NE, LT, GT, LE, GE, CASTC, CASTI, JUMP, JZ, JNZ,
+    CALL, NATIVE, RET, POP, OPCODES
+};
+
+static const unsigned operands[OPCODES] = {
+    0, 1, 1, 0, 0, 0, 1, 1, 1,
+    0, 0, 0, 1, 1, 1, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1,
+    2, 2, 0, 0
+};
+
+struct Routine {
+    intptr_t entry;
+    unsigned size, params;
+};
+
+struct Activation {
+    const intptr_t *pc;
+    char *fp, *top;
+};
+
+static const int WORD = sizeof(intptr_t);
+static const unsigned ARGUMENTS = 12;
+static const size_t OPERANDS = 1 << 20, ACTIVATIONS = 1 << 18;
+static const size_t FRAMES = 64 << 20, MARGIN = 256;
+
+static vector<intptr_t> code;
+static vector<Routine> routines;
+static map<string, unsigned> indices;
+static vector<string> natives;
+static vector<void *> callees;
+static map<const Symbol *, char *> addresses;
+static map<string, string> literals;
+static vector<size_t> *exits;
+static int frame;
+static bool failed;
+
+static const map<string, void *> builtins = {
+    {"printf", (void *) printf}, {"scanf", (void *) scanf},
+    {"malloc", (void *) malloc}, {"free", (void *) free},
+    {"putchar", (void *) putchar},
+};
+
+
+/*
+ * Function:	emit (private)
+ *
+ * Description:	Append an instruction to the code.
+ */
+
+static void emit(Opcode opcode)
+{
+    code.push_back(opcode);
+}
+
+static void emit(Opcode opcode, intptr_t operand)
+{
+    code.push_back(opcode);
+    code.push_back(operand);
+}
+
+
+/*
+ * Function:	jump (private)
+ *
+ * Description:	Append a jump whose target is not yet known, returning
+ *		where its target is to be patched.
+ */
+
+static size_t jump(Opcode opcode)
+{
+    emit(opcode, 0);
+    return code.size() - 1;
+}
+
+
+/*
+ * Function:	patch (private)
+ *
+ * Description:	Set the target of a jump to the end of the code.
+ */
+
+static void patch(size_t where)
+{
+    code[where] = code.size();
+}
+
+
+/*
+ * Function:	sized (private)
+ *
+ * Description:	Return the opcode for accessing a value of the given size.
+ */
+
+static Opcode sized(unsigned size, Opcode byte, Opcode word, Opcode pointer)
+{
+    return size == SIZEOF_CHAR ? byte : size == SIZEOF_INT ? word : pointer;
+}
+
+
+/*
+ * Function:	declare (private)
+ *
+ * Description:	Allocate space in the current frame for each variable
+ *		that has not already been allocated a word-aligned offset.
+ */
+
+static void declare(const Symbols &symbols)
+{
+    for (auto symbol : symbols)
+	if (symbol->_offset == 0 && !symbol->type().isFunction()) {
+	    symbol->_offset = frame;
+	    frame += (symbol->type().size() + WORD - 1) / WORD * WORD;
+	}
+}
+
+
+/*
+ * Function:	locate (private)
+ *
+ * Description:	Push the address of a variable.
+ */
+
+static void locate(const Symbol *symbol)
+{
+    if (symbol->_offset != 0)
+	emit(LOCAL, symbol->_offset);
+    else
+	emit(PUSH, (intptr_t) addresses[symbol]);
+}
+
+
+/*
+ * Function:	binary (private)
+ *
+ * Description:	Encode a binary operator.
+ */
+
+static void binary(Expression *left, Expression *right, Opcode opcode)
+{
+    left->encode();
+    right->encode();
+    emit(opcode);
+}
+
+
+/*
+ * Function:	Expression::encode
+ *
+ * Description:	Encode the expressions that push a value of their own.
+ */
+
+void Identifier::encode()
+{
+    if (_type.isArray())
+	locate(_symbol);
+    else if (_symbol->_offset != 0)
+	emit(sized(_type.size(), LOCALC, LOCALI, LOCALP), _symbol->_offset);
+    else {
+	locate(_symbol);
+	emit(sized(_type.size(), LOADC, LOADI, LOADP));
+    }
+}
+
+void Number::encode()
+{
+    unsigned value;
+
+    isNumber(value);
+    emit(PUSH, (int) value);
+}
+
+void String::encode()
+{
+    if (literals.count(_value) == 0)
+	literals[_value] = parseString(_value);
+
+    emit(PUSH, (intptr_t) literals[_value].c_str());
+}
+
+
+/*
+ * Function:	Call::encode
+ *
+ * Description:	Encode a function call.  The arguments are pushed in
+ *		order.  A function not defined in the program is called
+ *		natively, and its result truncated to its type.
+ */
+
+void Call::encode()
+{
+    for (auto arg : _args)
+	arg->encode();
+
+    if (indices.count(_id->name()) > 0) {
+	emit(CALL, indices[_id->name()]);
+	code.push_back(_args.size());
+	return;
+    }
+
+    if (_args.size() > ARGUMENTS) {
+	cerr << "scc: too many arguments to '" << _id->name() << "'" << endl;
+	failed = true;
+    }
+
+    natives.push_back(_id->name());
+    emit(NATIVE, natives.size() - 1);
+    code.push_back(_args.size());
+
+    if (_type.size() == SIZEOF_CHAR)
+	emit(CASTC);
+    else if (_type.size() == SIZEOF_INT && SIZEOF_INT < WORD)
+	emit(CASTI);
+}
+
+
+/*
+ * Function:	Inline::encode
+ *
+ * Description:	Encode an inlined function call.  Its variables are
+ *		allocated in our frame, and a return statement within the
+ *		body jumps to the end of the body with its result.
+ */
+
+void Inline::encode()
+{
+    vector<size_t> *saved = exits, pending;
+
+
+    declare(_body->declarations()->symbols());
+
+    for (auto param : _params)
+	param->encode();
+
+    exits = &pending;
+    _body->encode();
+    exits = saved;
+
+    emit(PUSH, 0);
+
+    for (auto where : pending)
+	patch(where);
+}
+
+
+/*
+ * Function:	Unary::encode
+ *
+ * Description:	Encode the unary operators.
+ */
+
+void Not::encode()
+{
+    _expr->encode();
+    emit(NOT);
+}
+
+void Negate::encode()
+{
+    _expr->encode();
+    emit(NEG);
+}
+
+void Dereference::encode()
+{
+    _expr->encode();
+
+    if (!_type.isArray())
+	emit(sized(_type.size(), LOADC, LOADI, LOADP));
+}
+
+void Address::encode()
+{
+    Expression *pointer;
+    const Symbol *symbol;
+
+
+    if (_expr->isDereference(pointer))
+	pointer->encode();
+    else if (_expr->isIdentifier(symbol))
+	locate(symbol);
+    else
+	_expr->encode();
+}
+
+void Cast::encode()
+{
+    _expr->encode();
+
+    if (_type.size() == SIZEOF_CHAR && _expr->type().size() != SIZEOF_CHAR)
+	emit(CASTC);
+    else if (_type.size() == SIZEOF_INT && _expr->type().size() > SIZEOF_INT)
+	emit(CASTI);
+}
+
+
+/*
+ * Function:	Binary::encode
+ *
+ * Description:	Encode the binary operators.  Arithmetic on integers is
+ *		truncated to an integer, but not arithmetic on pointers.
+ */
+
+void Multiply::encode()
+{
+    binary(_left, _right, MUL);
+}
+
+void Divide::encode()
+{
+    binary(_left, _right, DIV);
+}
+
+void Remainder::encode()
+{
+    binary(_left, _right, REM);
+}
+
+void Add::encode()
+{
+    binary(_left, _right, _type.size() == SIZEOF_INT ? ADD : ADDP);
+}
+
+void Subtract::encode()
+{
+    binary(_left, _right, _type.size() == SIZEOF_INT ? SUB : SUBP);
+}
+
+void LessThan::encode()
+{
+    binary(_left, _right, LT);
+}
+
+void GreaterThan::encode()
+{
+    binary(_left, _right, GT);
+}
+
+void LessOrEqual::encode()
+{
+    binary(_left, _right, LE);
+}
+
+void GreaterOrEqual::encode()
+{
+    binary(_left, _right, GE);
+}
+
+void Equal::encode()
+{
+    binary(_left, _right, EQ);
+}
+
+void NotEqual::encode()
+{
+    binary(_left, _right, NE);
+}
+
+
+/*
+ * Function:	LogicalAnd::encode
+ *
+ * Description:	Encode a logical-and expression, which yields zero as soon
+ *		as either operand is zero, and one otherwise.
+ */
+
+void LogicalAnd::encode()
+{
+    size_t left, right, exit;
+
+
+    _left->encode();
+    left = jump(JZ);
+    _right->encode();
+    right = jump(JZ);
+    emit(PUSH, 1);
+    exit = jump(JUMP);
+    patch(left);
+    patch(right);
+    emit(PUSH, 0);
+    patch(exit);
+}
+
+
+/*
+ * Function:	LogicalOr::encode
+ *
+ * Description:	Encode a logical-or expression, which yields one as soon as
+ *		either operand is nonzero, and zero otherwise.
+ */
+
+void LogicalOr::encode()
+{
+    size_t left, right, exit;
+
+
+    _left->encode();
+    left = jump(JNZ);
+    _right->encode();
+    right = jump(JNZ);
+    emit(PUSH, 0);
+    exit = jump(JUMP);
+    patch(left);
+    patch(right);
+    emit(PUSH, 1);
+    patch(exit);
+}
+
+
+/*
+ * Function:	Assignment::encode
+ *
+ * Description:	Encode an assignment statement, storing a local variable
+ *		directly and anything else through its address.
+ */
+
+void Assignment::encode()
+{
+    Expression *pointer;
+    const Symbol *symbol;
+    unsigned size = _left->type().size();
+
+
+    if (_left->isIdentifier(symbol) && symbol->_offset != 0) {
+	_right->encode();
+	emit(sized(size, SETC, SETI, SETP), symbol->_offset);
+	return;
+    }
+
+    if (_left->isDereference(pointer))
+	pointer->encode();
+    else if (_left->isIdentifier(symbol))
+	locate(symbol);
+
+    _right->encode();
+    emit(sized(size, STOREC, STOREI, STOREP));
+}
+
+
+/*
+ * Function:	Return::encode
+ *
+ * Description:	Encode a return statement, which within an inlined call
+ *		jumps to the end of the call instead.
+ */
+
+void Return::encode()
+{
+    _expr->encode();
+
+    if (exits != nullptr)
+	exits->push_back(jump(JUMP));
+    else
+	emit(RET);
+}
+
+
+/*
+ * Function:	Block::encode
+ *
+ * Description:	Encode a block, allocating space for its variables.
+ */
+
+void Block::encode()
+{
+    declare(_decls->symbols());
+
+    for (auto stmt : _stmts)
+	stmt->encode();
+}
+
+
+/*
+ * Function:	Simple::encode
+ *
+ * Description:	Encode an expression statement, discarding its value.
+ */
+
+void Simple::encode()
+{
+    _expr->encode();
+    emit(POP);
+}
+
+
+/*
+ * Function:	While::encode
+ *
+ * Description:	Encode a while statement.
+ */
+
+void While::encode()
+{
+    size_t start = code.size(), exit;
+
+
+    _expr->encode();
+    exit = jump(JZ);
+    _stmt->encode();
+    emit(JUMP, start);
+    patch(exit);
+}
+
+
+/*
+ * Function:	For::encode
+ *
+ * Description:	Encode a for statement.
+ */
+
+void For::encode()
+{
+    size_t start, exit;
+
+
+    _init->encode();
+    start = code.size();
+    _expr->encode();
+    exit = jump(JZ);
+    _stmt->encode();
+    _incr->encode();
+    emit(JUMP, start);
+    patch(exit);
+}
+
+
+/*
+ * Function:	If::encode
+ *
+ * Description:	Encode an if-then or if-then-else statement.
+ */
+
+void If::encode()
+{
+    size_t skip, exit;
+
+
+    _expr->encode();
+    skip = jump(JZ);
+    _thenStmt->encode();
+
+    if (_elseStmt == nullptr)
+	patch(skip);
+    else {
+	exit = jump(JUMP);
+	patch(skip);
+	_elseStmt->encode();
+	patch(exit);
+    }
+}
+
+
+/*
+ * Function:	Function::encode
+ *
+ * Description:	Encode a function, allocating its parameters in the words
+ *		after the first of its frame.  A function that falls off
+ *		its end returns zero.
+ */
+
+void Function::encode()
+{
+    Routine &routine = routines[indices[_id->name()]];
+    const Symbols &symbols = _body->declarations()->symbols();
+
+
+    routine.entry = code.size();
+    routine.params = _id->type().parameters()->size();
+    frame = WORD;
+
+    for (unsigned i = 0; i < routine.params; i ++) {
+	symbols[i]->_offset = frame;
+	frame += WORD;
+    }
+
+    exits = nullptr;
+    _body->encode();
+    emit(PUSH, 0);
+    emit(RET);
+    routine.size = frame;
+}
+
+
+/*
+ * Function:	encodeFunctions
+ *
+ * Description:	Encode the given functions, after allocating the global
+ *		variables, which are cleared.  The code begins by calling
+ *		main and halting with its result.
+ */
+
+void encodeFunctions(const Functions &functions, const Scope *globals)
+{
+    PhaseTimer timer(GENERATING);
+    unsigned size;
+    char *storage;
+
+
+    size = 0;
+
+    for (auto symbol : globals->symbols())
+	if (!symbol->type().isFunction())
+	    size += (symbol->type().size() + WORD - 1) / WORD * WORD;
+
+    storage = (char *) calloc(size + WORD, 1);
+
+    for (auto symbol : globals->symbols())
+	if (!symbol->type().isFunction()) {
+	    addresses[symbol] = storage;
+	    storage += (symbol->type().size() + WORD - 1) / WORD * WORD;
+	}
+
+    routines.resize(functions.size());
+
+    for (unsigned i = 0; i < functions.size(); i ++)
+	indices[functions[i]->id()->name()] = i;
+
+    emit(CALL, indices.count("main") > 0 ? indices["main"] : 0);
+    code.push_back(0);
+    emit(HALT);
+
+    for (auto function : functions)
+	function->encode();
+}
+
+
+/*
+ * Function:	loadProgram
+ *
+ * Description:	Find each function called natively, returning whether
+ *		there is a main function and the program may be run.
+ */
+
+bool loadProgram()
+{
+    void *function;
+
+
+    if (failed)
+	return false;
+
+    if (indices.count("main") == 0) {
+	cerr << "scc: no main function to run" << endl;
+	return false;
+    }
+
+    for (auto &name : natives) {
+	if (builtins.count(name) > 0)
+	    function = builtins.at(name);
+	else if ((function = dlsym(RTLD_DEFAULT, name.c_str())) == nullptr) {
+	    cerr << "scc: undefined symbol '" << name << "'" << endl;
+	    return false;
+	}
+
+	callees.push_back(function);
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	interpret
+ *
+ * Description:	Run the program loaded, returning the value returned by
+ *		its main function.  The code is first threaded, and then
+ *		each instruction jumps directly to the next.  With
+ *		-ftime-report, the number of instructions executed and how
+ *		many were executed per second are reported.
+ */
+
+int interpret()
+{
+    static void *const labels[OPCODES] = {
+	&&halt, &&push, &&local, &&loadc, &&loadi, &&loadp, &&localc,
+	&&locali, &&localp, &&storec, &&storei, &&storep, &&setc, &&seti,
+	&&setp, &&add, &&addp, &&sub, &&subp, &&mul, &&div, &&rem, &&neg,
+	&&lnot, &&eq, &&ne, &&lt, &&gt, &&le, &&ge, &&castc, &&casti,
+	&&jump, &&jz, &&jnz, &&call, &&native, &&ret, &&pop,
+    };
+
+    unique_ptr<intptr_t[]> stack(new intptr_t[OPERANDS]);
+    unique_ptr<Activation[]> activations(new Activation[ACTIVATIONS]);
+    unique_ptr<char[]> memory(new char[FRAMES]);
+
+    const intptr_t *pc, *base = code.data();
+    intptr_t *sp = stack.get(), args[ARGUMENTS], count, result;
+    Activation *rp = activations.get();
+    char *fp = memory.get(), *top = fp;
+    unsigned long executed = 0;
+    intptr_t (*function)(...);
+    const Routine *routine;
+    Opcode opcode;
+
+
+    /* Replace each opcode, jump target, and called function by its
+       address. */
+
+    for (auto &routine : routines)
+	routine.entry = (intptr_t) (base + routine.entry);
+
+    for (size_t i = 0; i < code.size(); i += 1 + operands[opcode]) {
+	opcode = (Opcode) code[i];
+
+	if (opcode == JUMP || opcode == JZ || opcode == JNZ)
+	    code[i + 1] = (intptr_t) (base + code[i + 1]);
+	else if (opcode == CALL)
+	    code[i + 1] = (intptr_t) &routines[code[i + 1]];
+	else if (opcode == NATIVE)
+	    code[i + 1] = (intptr_t) callees[code[i + 1]];
+
+	code[i] = (intptr_t) labels[opcode];
+    }
+
+    auto started = chrono::steady_clock::now();
+
+# define NEXT	do { executed ++; goto *(void *) *pc ++; } while (0)
+
+    pc = base;
+    NEXT;
+
+push:
+    *sp ++ = *pc ++;
+    NEXT;
+
+local:
+    *sp ++ = (intptr_t) (fp + *pc ++);
+    NEXT;
+
+loadc:
+    sp[-1] = *(signed char *) sp[-1];
+    NEXT;
+
+loadi:
+    sp[-1] = *(int *) sp[-1];
+    NEXT;
+
+loadp:
+    sp[-1] = *(intptr_t *) sp[-1];
+    NEXT;
+
+localc:
+    *sp ++ = *(signed char *) (fp + *pc ++);
+    NEXT;
+
+locali:
+    *sp ++ = *(int *) (fp + *pc ++);
+    NEXT;
+
+localp:
+    *sp ++ = *(intptr_t *) (fp + *pc ++);
+    NEXT;
+
+storec:
+    sp -= 2;
+    *(char *) sp[0] = sp[1];
+    NEXT;
+
+storei:
+    sp -= 2;
+    *(int *) sp[0] = sp[1];
+    NEXT;
+
+storep:
+    sp -= 2;
+    *(intptr_t *) sp[0] = sp[1];
+    NEXT;
+
+setc:
+    *(char *) (fp + *pc ++) = *-- sp;
+    NEXT;
+
+seti:
+    *(int *) (fp + *pc ++) = *-- sp;
+    NEXT;
+
+setp:
+    *(intptr_t *) (fp + *pc ++) = *-- sp;
+    NEXT;
+
+add:
+    sp --;
+    sp[-1] = (int) (sp[-1] + sp[0]);
+    NEXT;
+
+addp:
+    sp --;
+    sp[-1] += sp[0];
+    NEXT;
+
+sub:
+    sp --;
+    sp[-1] = (int) (sp[-1] - sp[0]);
+    NEXT;
+
+subp:
+    sp --;
+    sp[-1] -= sp[0];
+    NEXT;
+
+mul:
+    sp --;
+    sp[-1] = (int) (sp[-1] * sp[0]);
+    NEXT;
+
+div:
+    sp --;
+    sp[-1] = (int) sp[-1] / (int) sp[0];
+    NEXT;
+
+rem:
+    sp --;
+    sp[-1] = (int) sp[-1] % (int) sp[0];
+    NEXT;
+
+neg:
+    sp[-1] = (int) -sp[-1];
+    NEXT;
+
+lnot:
+    sp[-1] = !sp[-1];
+    NEXT;
+
+eq:
+    sp --;
+    sp[-1] = sp[-1] == sp[0];
+    NEXT;
+
+ne:
+    sp --;
+    sp[-1] = sp[-1] != sp[0];
+    NEXT;
+
+lt:
+    sp --;
+    sp[-1] = sp[-1] < sp[0];
+    NEXT;
+
+gt:
+    sp --;
+    sp[-1] = sp[-1] > sp[0];
+    NEXT;
+
+le:
+    sp --;
+    sp[-1] = sp[-1] <= sp[0];
+    NEXT;
+
+ge:
+    sp --;
+    sp[-1] = sp[-1] >= sp[0];
+    NEXT;
+
+castc:
+    sp[-1] = (signed char) sp[-1];
+    NEXT;
+
+casti:
+    sp[-1] = (int) sp[-1];
+    NEXT;
+
+jump:
+    pc = (const intptr_t *) *pc;
+    NEXT;
+
+jz:
+    pc = *-- sp == 0 ? (const intptr_t *) *pc : pc + 1;
+    NEXT;
+
+jnz:
+    pc = *-- sp != 0 ? (const intptr_t *) *pc : pc + 1;
+    NEXT;
+
+call:
+    routine = (const Routine *) pc[0];
+    count = pc[1];
+    pc += 2;
+
+    if (top + routine->size > memory.get() + FRAMES
+	    || rp == activations.get() + ACTIVATIONS
+	    || sp + MARGIN > stack.get() + OPERANDS) {
+	cerr << "scc: stack overflow" << endl;
+	return EXIT_FAILURE;
+    }
+
+    rp->pc = pc;
+    rp->fp = fp;
+    rp->top = top;
+    rp ++;
+
+    fp = top;
+    top = fp + routine->size;
+    sp -= count;
+
+    for (intptr_t i = 0; i < count && i < routine->params; i ++)
+	*(intptr_t *) (fp + WORD + i * WORD) = sp[i];
+
+    pc = (const intptr_t *) routine->entry;
+    NEXT;
+
+native:
+    function = (intptr_t (*)(...)) pc[0];
+    count = pc[1];
+    pc += 2;
+    sp -= count;
+
+    for (unsigned i = 0; i < ARGUMENTS; i ++)
+	args[i] = i < count ? sp[i] : 0;
+
+    *sp ++ = function(args[0], args[1], args[2], args[3], args[4],
+	args[5], args[6], args[7], args[8], args[9], args[10], args[11]);
+    NEXT;
+
+ret:
+    result = *-- sp;
+    rp --;
+    pc = rp->pc;
+    fp = rp->fp;
+    top = rp->top;
+    *sp ++ = result;
+    NEXT;
+
+pop:
+    sp --;
+    NEXT;
+
+halt:
+    if (time_report) {
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+	cerr << "scc: interpreted " << executed << " instructions in ";
+	cerr << seconds << "s (" << (seconds > 0 ? executed / seconds / 1e6 : 0);
+	cerr << " million per second)" << endl;
+    }
+
+    return (int) sp[-1];
+}
@@ -0,0 +1,19 @@
+/*
+ * File:	interpreter.h
+ *
+ * Description:	This file contains the function declarations for encoding
+ *		a program as bytecode and interpreting it.  Most of the
+ *		function declarations are actually member functions
+ *		provided as part of Tree.h.
+ */
+
+# ifndef INTERPRETER_H
+# define INTERPRETER_H
+# include "Scope.h"
+# include "Tree.h"
+
+void encodeFunctions(const Functions &functions, const Scope *globals);
+bool loadProgram();
+int interpret();
+
+# endif /* INTERPRETER_H */
@@ -0,0 +1,383 @@
+/*
+ * File:	jit.cpp
+ *
+ * Description:	This file contains the public and private function
+ *		definitions for loading the code generated into memory and
+ *		running it, so that no file need be written and no
+ *		assembler or linker run.
+ *
+ *		The code is linked into an arena of 512MB below 2GB, so that the
+ *		32-bit code can address all of it: the trampolines, 
+ *		then the text, data, and common symbols, then the heap, and
+ *		finally the stack.  On an x86-64 host, the code is run in
+ *		compatibility mode, entered by a far return to the 32-bit
+ *		code segment.
+ *
+ *		Each function called but not defined is given a stub that
+ *		returns to 64-bit mode and calls the function found by
+ *		dlsym with the first several words on the stack as its
+ *		arguments, since we do not know how many it takes.  The
+ *		allocation functions are replaced by our own, which
+ *		allocate from the arena, as memory returned by the C
+ *		library might not be addressable.  Only the functions of
+ *		the library that return no pointers or return pointers
+ *		given to them may therefore be called.
+ */
+
+# include <map>
+# include <vector>
+# include <cstdlib>
+# include <cstring>
+# include <iostream>
+# include "assembler.h"
+# include "jit.h"
+# include "timing.h"
+
+# if defined(__linux__) && defined(__x86_64__)
+# include <dlfcn.h>
+# include <sys/mman.h>
+
+using namespace std;
+
+static const unsigned long ARENA = 1UL << 29, STACK = 8UL << 20;
+static const unsigned long TRAMPOLINES = 1UL << 16;
+static const unsigned CODE32 = 0x23, CODE64 = 0x33, ARGUMENTS = 12;
+
+static char *arena, *heap, *limit, *freed[32];
+static unsigned long entry, stubs, common32;
+static vector<void *> functions;
+
+
+/*
+ * Function:	put (private)
+ *
+ * Description:	Append a value of the given number of bytes to some code,
+ *		least significant byte first.
+ */
+
+static void put(string &code, unsigned long value, unsigned size)
+{
+    for (unsigned i = 0; i < size; i ++)
+	code += (char) (value >> 8 * i);
+}
+
+
+/*
+ * Function:	allocate (private)
+ *
+ * Description:	Allocate a block from the heap in the arena.  Each block
+ *		is a power of two in size, starting with a header giving
+ *		the size, and a freed block is kept on a list for its size.
+ */
+
+static unsigned long allocate(unsigned long size)
+{
+    unsigned bucket = 0;
+    char *block;
+
+
+    while ((16UL << bucket) < size + 16)
+	bucket ++;
+
+    if (freed[bucket] != nullptr) {
+	block = freed[bucket];
+	freed[bucket] = *(char **) (block + 8);
+    } else if (heap + (16UL << bucket) <= limit) {
+	block = heap;
+	heap += 16UL << bucket;
+    } else
+	return 0;
+
+    *(unsigned *) block = bucket;
+    return (unsigned long) block + 16;
+}
+
+
+/*
+ * Function:	release (private)
+ *
+ * Description:	Free a block allocated from the heap in the arena.
+ */
+
+static unsigned long release(unsigned long pointer)
+{
+    char *block = (char *) pointer - 16;
+    unsigned bucket;
+
+
+    if (pointer != 0) {
+	bucket = *(unsigned *) block;
+	*(char **) (block + 8) = freed[bucket];
+	freed[bucket] = block;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Function:	callocate (private)
+ *
+ * Description:	Allocate a cleared block for an array.
+ */
+
+static unsigned long callocate(unsigned long count, unsigned long size)
+{
+    unsigned long pointer = allocate(count * size);
+
+
+    if (pointer != 0)
+	memset((char *) pointer, 0, count * size);
+
+    return pointer;
+}
+
+
+/*
+ * Function:	reallocate (private)
+ *
+ * Description:	Change the size of a block, moving it if it is too small.
+ */
+
+static unsigned long reallocate(unsigned long pointer, unsigned long size)
+{
+    unsigned long capacity, result;
+
+
+    if (pointer == 0)
+	return allocate(size);
+
+    capacity = (16UL << *(unsigned *) (pointer - 16)) - 16;
+
+    if (size <= capacity)
+	return pointer;
+
+    if ((result = allocate(size)) != 0) {
+	memcpy((char *) result, (char *) pointer, capacity);
+	release(pointer);
+    }
+
+    return result;
+}
+
+
+static const map<string, void *> replacements = {
+    {"malloc", (void *) allocate}, {"free", (void *) release},
+    {"calloc", (void *) callocate}, {"realloc", (void *) reallocate},
+};
+
+
+/*
+ * Function:	dispatch (private)
+ *
+ * Description:	Call the function for the given stub with the words on
+ *		the stack of the 32-bit code as its arguments.
+ */
+
+static unsigned long dispatch(unsigned index, const unsigned *args)
+{
+    unsigned long (*function)(...);
+
+
+    function = (unsigned long (*)(...)) functions[index];
+
+    return function((unsigned long) args[0], (unsigned long) args[1],
+	(unsigned long) args[2], (unsigned long) args[3],
+	(unsigned long) args[4], (unsigned long) args[5],
+	(unsigned long) args[6], (unsigned long) args[7],
+	(unsigned long) args[8], (unsigned long) args[9],
+	(unsigned long) args[10], (unsigned long) args[11]);
+}
+
+
+/*
+ * Function:	trampolines (private)
+ *
+ * Description:	Write the code to enter and leave compatibility mode at
+ *		the start of the arena.  The code to enter is called with
+ *		the address of the function and the stack to use, saves the
+ *		registers and stack pointer of the caller at the top of the
+ *		arena, and returns the result.  Each stub pushes its index
+ *		and jumps to the common code to call the function.
+ */
+
+static void trampolines()
+{
+    unsigned long base = (unsigned long) arena;
+    unsigned long saved = base + ARENA - 8;
+    string code;
+
+
+    /* Enter compatibility mode and call the function. */
+
+    code += "\x53\x55\x41\x54\x41\x55\x41\x56\x41\x57";
+    code += "\x48\x89\x24\x25";
+    put(code, saved, 4);
+    code += "\x48\x89\xf4\x8c\xd0\x8e\xd8\x8e\xc0\x6a";
+    put(code, CODE32, 1);
+    code += "\x68";
+    put(code, base + code.size() + 6, 4);
+    code += "\x48\xcb";
+
+    code += "\xff\xd7\xea";
+    put(code, base + code.size() + 6, 4);
+    put(code, CODE64, 2);
+
+    code += "\x48\x8b\x24\x25";
+    put(code, saved, 4);
+    code += "\x41\x5f\x41\x5e\x41\x5d\x41\x5c\x5d\x5b\xc3";
+
+
+    /* Leave compatibility mode to call a function and return. */
+
+    common32 = base + code.size();
+    code += "\xea";
+    put(code, base + code.size() + 6, 4);
+    put(code, CODE64, 2);
+
+    code += "\x89\xe4\x53\x48\x89\xe3\x8b\x7b\x08\x48\x8d\x73\x10";
+    code += "\x48\x83\xe4\xf0\x48\xb8";
+    put(code, (unsigned long) dispatch, 8);
+    code += "\xff\xd0\x48\x89\xdc\x5b\x6a";
+    put(code, CODE32, 1);
+    code += "\x68";
+    put(code, base + code.size() + 6, 4);
+    code += "\x48\xcb";
+
+    code += "\x83\xc4\x04\xc3";
+
+    memcpy(arena, code.data(), code.size());
+    stubs = base + code.size();
+}
+
+
+/*
+ * Function:	stub (private)
+ *
+ * Description:	Return the address of a new stub to call the function with
+ *		the given name, or zero if there is no such function.
+ */
+
+static unsigned long stub(const string &name)
+{
+    unsigned long address = stubs + functions.size() * 10;
+    string code;
+    void *function;
+
+
+    if (replacements.count(name) > 0)
+	function = replacements.at(name);
+    else if ((function = dlsym(RTLD_DEFAULT, name.c_str())) == nullptr)
+	return 0;
+
+    if (address + 10 > (unsigned long) arena + TRAMPOLINES)
+	return 0;
+
+    code += "\x68";
+    put(code, functions.size(), 4);
+    code += "\xe9";
+    put(code, common32 - (address + 10), 4);
+    memcpy((char *) address, code.data(), code.size());
+
+    functions.push_back(function);
+    return address;
+}
+
+
+/*
+ * Function:	load
+ *
+ * Description:	Link the code generated into the arena, returning whether
+ *		it has a main function to be run.
+ */
+
+bool load(const string &text)
+{
+    PhaseTimer timer(LOADING);
+    map<string, unsigned long> globals;
+    string image;
+    void *memory;
+
+
+    memory = mmap(nullptr, ARENA, PROT_READ | PROT_WRITE,
+	MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_32BIT, -1, 0);
+
+    if (memory == MAP_FAILED) {
+	cerr << "scc: cannot allocate memory to run the program" << endl;
+	return false;
+    }
+
+    arena = (char *) memory;
+    trampolines();
+
+    if (!link(text, (unsigned long) arena + TRAMPOLINES, stub, image, globals))
+	return false;
+
+    if (globals.count("main") == 0) {
+	cerr << "scc: no main function to run" << endl;
+	return false;
+    }
+
+    if (TRAMPOLINES + image.size() + STACK > ARENA) {
+	cerr << "scc: program is too large to run" << endl;
+	return false;
+    }
+
+    memcpy(arena + TRAMPOLINES, image.data(), image.size());
+    mprotect(arena, TRAMPOLINES + image.size(), PROT_READ | PROT_WRITE | PROT_EXEC);
+
+    entry = globals["main"];
+    heap = arena + TRAMPOLINES + image.size();
+    heap += -(unsigned long) heap % 16;
+    limit = arena + ARENA - STACK;
+    return true;
+}
+
+
+/*
+ * Function:	run
+ *
+ * Description:	Run the program loaded, returning the value returned by
+ *		its main function.  Enough of the stack is left above the
+ *		arguments of main for the words passed to any function.
+ */
+
+int run()
+{
+    int (*enter)(unsigned long, unsigned long);
+
+
+    enter = (int (*)(unsigned long, unsigned long)) arena;
+    return enter(entry, (unsigned long) arena + ARENA - 8 - ARGUMENTS * 4);
+}
+
+# else
+
+using namespace std;
+
+
+/*
+ * Function:	load
+ *
+ * Description:	Report that the code generated cannot be run here.
+ */
+
+bool load(const string &text)
+{
+    cerr << "scc: --run is supported only on x86-64 Linux" << endl;
+    return false;
+}
+
+
+/*
+ * Function:	run
+ *
+ * Description:	Do nothing, since nothing can be loaded.
+ */
+
+int run()
+{
+    return EXIT_FAILURE;
+}
+
+# endif
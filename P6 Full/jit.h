@@ -0,0 +1,15 @@
+/*
+ * File:	jit.h
+ *
+ * Description:	This file contains the function declarations for loading
+ *		the code generated into memory and running it.
+ */
+
+# ifndef JIT_H
+# define JIT_H
+# include <string>
+
+bool load(const std::string &text);
+int run();
+
+# endif /* JIT_H */
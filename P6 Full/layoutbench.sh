@@ -0,0 +1,86 @@
+#!/bin/sh
+#
+# layoutbench.sh - count the branches taken by the code scc generates
+#
+# Each program in the examples directory is compiled by scc -m64 -O in
+# three ways: with the code laid out as written (-fno-reorder-blocks),
+# laid out by the static heuristics, and laid out using a profile
+# written by an instrumented build run on the same input.  Each build is
+# run on its input under the branches tool, and the table gives the
+# branches executed (conditional branches plus jumps) and the branches
+# taken (conditional branches taken plus jumps) by each.  The outputs of
+# the three must match.  The table is also written to layoutbench.log.
+#
+# usage: layoutbench.sh [program ...]
+#
+
+SCC=./scc
+BRANCHES=./branches
+DIR=examples
+LOG=layoutbench.log
+WORKDIR=${TMPDIR:-/tmp}/scc-layoutbench.$$
+
+trap 'rm -rf $WORKDIR' 0
+trap 'exit 1' 1 2 15
+mkdir -p $WORKDIR || exit 1
+
+programs=${*:-`cd $DIR && ls *.c | sed 's/\.c$//'`}
+
+
+# Compile the given program with the given options and run it under the
+# branches tool, printing the branches executed and taken.  The output
+# of the program is kept in $WORKDIR/output.
+
+count() {
+    program=$1
+    shift
+
+    $SCC -m64 -O "$@" < $DIR/$program.c > $WORKDIR/a.s 2> /dev/null &&
+	gcc -o $WORKDIR/a.out $WORKDIR/a.s 2> /dev/null || return 1
+
+    $BRANCHES $WORKDIR/a.out < $DIR/$program.in > $WORKDIR/output 2> $WORKDIR/counts
+    sed -n 's/^branches: \([0-9]*\) conditional, \([0-9]*\) taken, \([0-9]*\) jumps$/\1 \2 \3/p' \
+	$WORKDIR/counts | awk '{ print $1 + $3, $2 + $3 }'
+}
+
+
+printf "%-8s %30s %30s\n" "" "branches executed" "branches taken" | tee $LOG
+printf "%-8s %10s %9s %9s %10s %9s %9s\n" program written static profile \
+    written static profile | tee -a $LOG
+
+for program in $programs; do
+    profile=$WORKDIR/$program.prof
+
+    if ! written=`count $program -fno-reorder-blocks` || [ -z "$written" ]; then
+	echo "$program: scc+gcc -m64 failed" 1>&2
+	continue
+    fi
+
+    cp $WORKDIR/output $WORKDIR/expected
+    static=`count $program`
+    cmp -s $WORKDIR/output $WORKDIR/expected || static=
+
+    rm -f $profile
+    $SCC -m64 -O -fprofile-generate=$profile < $DIR/$program.c > $WORKDIR/a.s 2> /dev/null &&
+	gcc -o $WORKDIR/a.out $WORKDIR/a.s 2> /dev/null &&
+	$WORKDIR/a.out < $DIR/$program.in > /dev/null 2>&1
+    used=`count $program -fprofile-use=$profile`
+    cmp -s $WORKDIR/output $WORKDIR/expected || used=
+
+    if [ -z "$static" ] || [ -z "$used" ]; then
+	echo "$program: output differs from that laid out as written" 1>&2
+	continue
+    fi
+
+    echo $program $written $static $used
+done | awk '
+    {
+	printf "%-8s %10d %9d %9d %10d %9d %9d\n", $1, $2, $4, $6, $3, $5, $7
+	for (i = 2; i <= 7; i ++)
+	    total[i] += $i
+    }
+    END {
+	printf "%-8s %10d %9d %9d %10d %9d %9d\n", "total", total[2], total[4],
+	    total[6], total[3], total[5], total[7]
+    }
+' | tee -a $LOG
@@ -0,0 +1,75 @@
+#!/bin/sh
+#
+# leakcheck.sh - check that the compile server does not grow per request
+#
+# A compile server is started with the given options, and the program
+# is sent to it repeatedly with scc-client.  The resident set size of
+# the server is taken after a first round of requests, once its heap
+# and threads are warmed up, and again after a second round of the same
+# size.  The growth per request in the second round is reported, and
+# the check fails if it exceeds the limit, since each request should
+# free everything it allocated.
+#
+# usage: leakcheck.sh [program [option ...]]
+#
+
+SCC=./scc
+CLIENT=./scc-client
+DIR=examples
+REQUESTS=${REQUESTS:-500}
+LIMIT=${LIMIT:-512}
+WORKDIR=${TMPDIR:-/tmp}/scc-leakcheck.$$
+SOCKET=$WORKDIR/socket
+
+trap 'kill $server 2> /dev/null; rm -rf $WORKDIR' 0
+trap 'exit 1' 1 2 15
+mkdir -p $WORKDIR || exit 1
+
+program=${1:-qsort}
+[ $# -gt 0 ] && shift
+options=${*:--O}
+
+
+# Send the program to the server the given number of times.
+
+requests() {
+    n=0
+
+    while [ $n -lt $1 ]; do
+	if ! $CLIENT $SOCKET < $DIR/$program.c > /dev/null; then
+	    echo "$program: request failed" 1>&2
+	    exit 1
+	fi
+
+	n=`expr $n + 1`
+    done
+}
+
+
+# Print the resident set size of the server in kilobytes.
+
+rss() {
+    awk '/^VmRSS:/ { print $2 }' /proc/$server/status
+}
+
+
+$SCC $options --server $SOCKET 2> /dev/null &
+server=$!
+
+while [ ! -S $SOCKET ]; do
+    kill -0 $server 2> /dev/null || exit 1
+    sleep 0.1
+done
+
+requests $REQUESTS
+before=`rss`
+requests $REQUESTS
+after=`rss`
+
+growth=`expr \( $after - $before \) \* 1024 / $REQUESTS`
+echo "$program $options: $before KB -> $after KB after $REQUESTS requests, $growth bytes per request"
+
+if [ $growth -gt $LIMIT ]; then
+    echo "$program: server grows by more than $LIMIT bytes per request" 1>&2
+    exit 1
+fi
@@ -18,9 +18,15 @@
 # include "string.h"
 # include "tokens.h"
 # include "lexer.h"
+# include "timing.h"
 
 using namespace std;
-int numerrors, lineno = 1;
+thread_local int lineno = 1, numerrors;
+thread_local string filename;
+thread_local ostream *diagnostics = &cerr;
+
+static thread_local istream *input;
+static thread_local int c;
 
 
 /* Later, we will associate token values with each keyword */
@@ -64,11 +70,12 @@ static map<string, int> keywords = {
 /*
  * Function:	report
  *
- * Description:	Report an error to the standard error prefixed with the
- *		line number.  We'll be using this a lot later with an
- *		optional string argument, but C++'s stupid streams don't do
- *		positional arguments, so we actually resort to snprintf.
- *		You just can't beat C for doing things down and dirty.
+ * Description:	Report an error to the diagnostic stream, which is usually
+ *		the standard error, prefixed with the line number.  We'll
+ *		be using this a lot later with an optional string argument,
+ *		but C++'s stupid streams don't do positional arguments, so
+ *		we actually resort to snprintf.  You just can't beat C for
+ *		doing things down and dirty.
  */
 
 void report(const string &str, const string &arg)
@@ -76,31 +83,65 @@ void report(const string &str, const string &arg)
     char buf[1000];
 
     snprintf(buf, sizeof(buf), str.c_str(), arg.c_str());
-    cerr << "line " << lineno << ": " << buf << endl;
+
+    if (!filename.empty())
+	*diagnostics << filename << ": ";
+
+    *diagnostics << "line " << lineno << ": " << buf << endl;
     numerrors ++;
 }
 
 
+/*
+ * Function:	isKeyword
+ *
+ * Description:	Return whether a word is a keyword rather than an
+ *		identifier.
+ */
+
+bool isKeyword(const string &word)
+{
+    return keywords.count(word) > 0;
+}
+
+
+/*
+ * Function:	setInput
+ *
+ * Description:	Start reading tokens from the given input stream.  Each
+ *		thread reads from its own stream.
+ */
+
+void setInput(istream &in)
+{
+    input = &in;
+    c = input->get();
+    lineno = 1;
+}
+
+
 /*
  * Function:	lexan
  *
- * Description:	Read and tokenize the standard input stream.  The lexeme is
- *		stored in a buffer.
+ * Description:	Read and tokenize the input stream.  The lexeme is stored
+ *		in a buffer.
  */
 
 int lexan(string &lexbuf)
 {
-    static int c = cin.get();
     bool invalid, overflow;
     long val;
     int p;
+    PhaseTimer timer(LEXING);
+
 
+    count(TOKENS);
 
     /* The invariant here is that the next character has already been read
        and is ready to be classified.  In this way, we eliminate having to
        push back characters onto the stream, merely to read them again. */
 
-    while (!cin.eof()) {
+    while (!input->eof()) {
 	lexbuf.clear();
 
 
@@ -110,7 +151,7 @@ int lexan(string &lexbuf)
 	    if (c == '\n')
 		lineno ++;
 
-	    c = cin.get();
+	    c = input->get();
 	}
 
 
@@ -119,11 +160,11 @@ int lexan(string &lexbuf)
 	if (isalpha(c) || c == '_') {
 	    do {
 		lexbuf += c;
-		c = cin.get();
+		c = input->get();
 	    } while (isalnum(c) || c == '_');
 
 	    if (keywords.count(lexbuf) > 0)
-		return keywords[lexbuf];
+		return keywords.at(lexbuf);
 
 	    return ID;
 
@@ -133,7 +174,7 @@ int lexan(string &lexbuf)
 	} else if (isdigit(c)) {
 	    do {
 		lexbuf += c;
-		c = cin.get();
+		c = input->get();
 	    } while (isdigit(c));
 
 	    errno = 0;
@@ -159,11 +200,11 @@ int lexan(string &lexbuf)
 	    /* Check for '||' */
 
 	    case '|':
-		c = cin.get();
+		c = input->get();
 
 		if (c == '|') {
 		    lexbuf += c;
-		    c = cin.get();
+		    c = input->get();
 		}
 
 		return OR;
@@ -172,11 +213,11 @@ int lexan(string &lexbuf)
 	    /* Check for '=' and '==' */
 
 	    case '=':
-		c = cin.get();
+		c = input->get();
 
 		if (c == '=') {
 		    lexbuf += c;
-		    c = cin.get();
+		    c = input->get();
 		    return EQL;
 		}
 
@@ -186,11 +227,11 @@ int lexan(string &lexbuf)
 	    /* Check for '&' and '&&' */
 
 	    case '&':
-		c = cin.get();
+		c = input->get();
 
 		if (c == '&') {
 		    lexbuf += c;
-		    c = cin.get();
+		    c = input->get();
 		    return AND;
 		}
 
@@ -200,11 +241,11 @@ int lexan(string &lexbuf)
 	    /* Check for '!' and '!=' */
 
 	    case '!':
-		c = cin.get();
+		c = input->get();
 
 		if (c == '=') {
 		    lexbuf += c;
-		    c = cin.get();
+		    c = input->get();
 		    return NEQ;
 		}
 
@@ -214,11 +255,11 @@ int lexan(string &lexbuf)
 	    /* Check for '<' and '<=' */
 
 	    case '<':
-		c = cin.get();
+		c = input->get();
 
 		if (c == '=') {
 		    lexbuf += c;
-		    c = cin.get();
+		    c = input->get();
 		    return LEQ;
 		}
 
@@ -228,11 +269,11 @@ int lexan(string &lexbuf)
 	    /* Check for '>' and '>=' */
 
 	    case '>':
-		c = cin.get();
+		c = input->get();
 
 		if (c == '=') {
 		    lexbuf += c;
-		    c = cin.get();
+		    c = input->get();
 		    return GEQ;
 		}
 
@@ -242,16 +283,16 @@ int lexan(string &lexbuf)
 	    /* Check for '-', '--', and '->' */
 
 	    case '-':
-		c = cin.get();
+		c = input->get();
 
 		if (c == '-') {
 		    lexbuf += c;
-		    c = cin.get();
+		    c = input->get();
 		    return DEC;
 
 		} else if (c == '>') {
 		    lexbuf += c;
-		    c = cin.get();
+		    c = input->get();
 		    return ARROW;
 		}
 
@@ -261,11 +302,11 @@ int lexan(string &lexbuf)
 	    /* Check for '+' and '++' */
 
 	    case '+':
-		c = cin.get();
+		c = input->get();
 
 		if (c == '+') {
 		    lexbuf += c;
-		    c = cin.get();
+		    c = input->get();
 		    return INC;
 		}
 
@@ -277,28 +318,28 @@ int lexan(string &lexbuf)
 	    case '*': case '%': case ':': case ';':
 	    case '(': case ')': case '[': case ']':
 	    case '{': case '}': case '.': case ',':
-		c = cin.get();
+		c = input->get();
 		return lexbuf[0];
 
 
 	    /* Check for '/' or a comment */
 
 	    case '/':
-		c = cin.get();
+		c = input->get();
 
 		if (c == '*') {
 		    do {
-			while (c != '*' && !cin.eof()) {
+			while (c != '*' && !input->eof()) {
 			    if (c == '\n')
 				lineno ++;
 
-			    c = cin.get();
+			    c = input->get();
 			}
 
-			c = cin.get();
-		    } while (c != '/' && !cin.eof());
+			c = input->get();
+		    } while (c != '/' && !input->eof());
 
-		    c = cin.get();
+		    c = input->get();
 		    break;
 
 		} else
@@ -310,15 +351,15 @@ int lexan(string &lexbuf)
 	    case '"':
 		do {
 		    p = c;
-		    c = cin.get();
+		    c = input->get();
 		    lexbuf += c;
 
 		    if (c == '\n')
 			lineno ++;
 
-		} while (p == '\\' || (c != '"' && c != '\n' && !cin.eof()));
+		} while (p == '\\' || (c != '"' && c != '\n' && !input->eof()));
 
-		if (c == '\n' || cin.eof())
+		if (c == '\n' || input->eof())
 		    report("prematured end of string literal");
 		else {
 		    parseString(lexbuf, invalid, overflow);
@@ -329,7 +370,7 @@ int lexan(string &lexbuf)
 			report("escape sequence out of range in string literal");
 		}
 
-		c = cin.get();
+		c = input->get();
 		return STRING;
 
 
@@ -342,7 +383,7 @@ int lexan(string &lexbuf)
 	    /* Everything else is illegal */
 
 	    default:
-		c = cin.get();
+		c = input->get();
 		return ERROR;
 	    }
 	}
@@ -8,9 +8,15 @@
 # ifndef LEXER_H
 # define LEXER_H
 # include <string>
+# include <istream>
+# include <ostream>
 
-extern int lineno, numerrors;
+extern thread_local int lineno, numerrors;
+extern thread_local std::string filename;
+extern thread_local std::ostream *diagnostics;
 
+bool isKeyword(const std::string &word);
+void setInput(std::istream &in);
 int lexan(std::string &lexbuf);
 void report(const std::string &str, const std::string &arg = "");
 
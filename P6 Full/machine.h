@@ -2,26 +2,37 @@
  * File:	machine.h
  *
  * Description:	This file contains the values of various parameters for the
- *		target machine architecture.
+ *		target machine architecture.  The target is the Intel
+ *		32-bit processor unless -m64 selects x86-64, where pointers,
+ *		registers, and arguments on the stack are eight bytes and
+ *		the first six arguments are passed in registers.
  */
 
+extern bool m64;
+
 # define SIZEOF_CHAR 1
 # define SIZEOF_INT 4
-# define SIZEOF_PTR 4
-# define SIZEOF_REG 4
-# define SIZEOF_ARG 4
+# define SIZEOF_PTR (m64 ? 8 : 4)
+# define SIZEOF_REG (m64 ? 8 : 4)
+# define SIZEOF_ARG (m64 ? 8 : 4)
+# define NUM_ARG_REGS (m64 ? 6U : 0U)
+
+# define stack_pointer (m64 ? "%rsp" : "%esp")
+# define frame_pointer (m64 ? "%rbp" : "%ebp")
 
 # if defined (__linux__) && (defined(__i386__) || defined(__x86_64__))
 
-# define STACK_ALIGNMENT 4
+# define STACK_ALIGNMENT (m64 ? 16 : 4)
 # define global_prefix ""
 # define label_prefix ".L"
+# define readonly_section ".section\t.rodata"
 
 # elif defined (__APPLE__) && (defined(__i386__) || defined(__x86_64__))
 
 # define STACK_ALIGNMENT 16
 # define global_prefix "_"
 # define label_prefix "L"
+# define readonly_section ".const"
 
 # else
 
@@ -0,0 +1,615 @@
+/*
+ * File:	optimizer.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		simplifying the abstract syntax tree of a function before
+ *		generating code for it.  The actual classes are declared
+ *		elsewhere, mainly in Tree.h.
+ *
+ *		The simplifications performed are:
+ *		- folding operators whose operands are constants
+ *		- removing branches whose conditions are constants
+ *		- removing statements following a return statement
+ *		- removing expression statements that have no effect
+ *		- removing assignments to local variables never read
+ *
+ *		A local variable is considered read if its identifier
+ *		appears anywhere other than as the target of an
+ *		assignment, which includes taking its address.  We also
+ *		note whether the address of any local variable is taken,
+ *		since the frame of such a function cannot be reused.
+ */
+
+# include <set>
+# include <climits>
+# include <iostream>
+# include "options.h"
+# include "timing.h"
+# include "lexer.h"
+# include "Tree.h"
+
+using namespace std;
+
+static thread_local bool pruning;
+static thread_local unsigned eliminated;
+static thread_local set<const Symbol *> locals, used, addressed;
+
+
+/*
+ * Function:	nonempty (private)
+ *
+ * Description:	Return the given statement, or an empty block if the
+ *		statement has been removed, for use where a statement is
+ *		required.
+ */
+
+static Statement *nonempty(Statement *stmt)
+{
+    if (stmt == nullptr)
+	return new Block(new Scope(), Statements());
+
+    return stmt;
+}
+
+
+/*
+ * Function:	Unary::calculate
+ *
+ * Description:	Compute the result of a unary operator given a constant
+ *		operand, returning whether the result could be computed.
+ */
+
+bool Unary::calculate(int operand, int &result) const
+{
+    return false;
+}
+
+bool Not::calculate(int operand, int &result) const
+{
+    result = !operand;
+    return true;
+}
+
+bool Negate::calculate(int operand, int &result) const
+{
+    if (operand == INT_MIN)
+	return false;
+
+    result = -operand;
+    return true;
+}
+
+
+/*
+ * Function:	Binary::calculate
+ *
+ * Description:	Compute the result of a binary operator given constant
+ *		operands, returning whether the result could be computed.
+ *		Anything that would overflow or trap is left for run time.
+ */
+
+bool Binary::calculate(int left, int right, int &result) const
+{
+    return false;
+}
+
+bool Multiply::calculate(int left, int right, int &result) const
+{
+    long long value = (long long) left * right;
+
+    result = value;
+    return value == result;
+}
+
+bool Divide::calculate(int left, int right, int &result) const
+{
+    if (right == 0 || (left == INT_MIN && right == -1))
+	return false;
+
+    result = left / right;
+    return true;
+}
+
+bool Remainder::calculate(int left, int right, int &result) const
+{
+    if (right == 0 || (left == INT_MIN && right == -1))
+	return false;
+
+    result = left % right;
+    return true;
+}
+
+bool Add::calculate(int left, int right, int &result) const
+{
+    long long value = (long long) left + right;
+
+    result = value;
+    return value == result;
+}
+
+bool Subtract::calculate(int left, int right, int &result) const
+{
+    long long value = (long long) left - right;
+
+    result = value;
+    return value == result;
+}
+
+bool LessThan::calculate(int left, int right, int &result) const
+{
+    result = left < right;
+    return true;
+}
+
+bool GreaterThan::calculate(int left, int right, int &result) const
+{
+    result = left > right;
+    return true;
+}
+
+bool LessOrEqual::calculate(int left, int right, int &result) const
+{
+    result = left <= right;
+    return true;
+}
+
+bool GreaterOrEqual::calculate(int left, int right, int &result) const
+{
+    result = left >= right;
+    return true;
+}
+
+bool Equal::calculate(int left, int right, int &result) const
+{
+    result = left == right;
+    return true;
+}
+
+bool NotEqual::calculate(int left, int right, int &result) const
+{
+    result = left != right;
+    return true;
+}
+
+
+/*
+ * Function:	Unary::fold
+ *
+ * Description:	Fold a unary operator, replacing it with a number if its
+ *		operand is a constant.
+ */
+
+Expression *Unary::fold()
+{
+    unsigned value;
+    int result;
+
+
+    _expr = _expr->fold();
+
+    if (_expr->isNumber(value) && calculate(value, result))
+	return new Number(result);
+
+    return this;
+}
+
+
+/*
+ * Function:	Binary::fold
+ *
+ * Description:	Fold a binary operator, replacing it with a number if both
+ *		of its operands are constants.
+ */
+
+Expression *Binary::fold()
+{
+    unsigned left, right;
+    int result;
+
+
+    _left = _left->fold();
+    _right = _right->fold();
+
+    if (_left->isNumber(left) && _right->isNumber(right))
+	if (calculate(left, right, result))
+	    return new Number(result);
+
+    return this;
+}
+
+
+/*
+ * Function:	LogicalAnd::fold
+ *
+ * Description:	Fold a logical-and expression.  If the left operand is
+ *		false, then the right operand is never evaluated.
+ */
+
+Expression *LogicalAnd::fold()
+{
+    unsigned left, right;
+
+
+    _left = _left->fold();
+    _right = _right->fold();
+
+    if (_left->isNumber(left)) {
+	if (left == 0)
+	    return new Number(0);
+
+	if (_right->isNumber(right))
+	    return new Number(right != 0);
+    }
+
+    return this;
+}
+
+
+/*
+ * Function:	LogicalOr::fold
+ *
+ * Description:	Fold a logical-or expression.  If the left operand is
+ *		true, then the right operand is never evaluated.
+ */
+
+Expression *LogicalOr::fold()
+{
+    unsigned left, right;
+
+
+    _left = _left->fold();
+    _right = _right->fold();
+
+    if (_left->isNumber(left)) {
+	if (left != 0)
+	    return new Number(1);
+
+	if (_right->isNumber(right))
+	    return new Number(right != 0);
+    }
+
+    return this;
+}
+
+
+/*
+ * Function:	Call::fold
+ *
+ * Description:	Fold the arguments of a function call.
+ */
+
+Expression *Call::fold()
+{
+    for (auto &arg : _args)
+	arg = arg->fold();
+
+    return this;
+}
+
+
+/*
+ * Function:	Identifier::mark
+ *
+ * Description:	Mark the symbol of an identifier as being read.  From this
+ *		point on are the functions for marking the symbols read in
+ *		the rest of the tree, which simply visit each child.
+ */
+
+void Identifier::mark() const
+{
+    used.insert(_symbol);
+}
+
+void Unary::mark() const
+{
+    _expr->mark();
+}
+
+void Binary::mark() const
+{
+    _left->mark();
+    _right->mark();
+}
+
+void Address::mark() const
+{
+    const Symbol *symbol;
+
+    if (_expr->isIdentifier(symbol))
+	addressed.insert(symbol);
+
+    _expr->mark();
+}
+
+void Call::mark() const
+{
+    for (auto arg : _args)
+	arg->mark();
+}
+
+void Assignment::mark() const
+{
+    Expression *pointer;
+
+    if (_left->isDereference(pointer))
+	pointer->mark();
+
+    _right->mark();
+}
+
+void Return::mark() const
+{
+    _expr->mark();
+}
+
+void Block::mark() const
+{
+    for (auto stmt : _stmts)
+	stmt->mark();
+}
+
+void While::mark() const
+{
+    _expr->mark();
+    _stmt->mark();
+}
+
+void For::mark() const
+{
+    _init->mark();
+    _expr->mark();
+    _incr->mark();
+    _stmt->mark();
+}
+
+void If::mark() const
+{
+    _expr->mark();
+    _thenStmt->mark();
+
+    if (_elseStmt != nullptr)
+	_elseStmt->mark();
+}
+
+void Simple::mark() const
+{
+    _expr->mark();
+}
+
+
+/*
+ * Function:	Return::returns
+ *
+ * Description:	Return whether a statement always returns from the
+ *		function, in which case any statement following it is
+ *		unreachable.
+ */
+
+bool Return::returns() const
+{
+    return true;
+}
+
+bool Block::returns() const
+{
+    return !_stmts.empty() && _stmts.back()->returns();
+}
+
+bool If::returns() const
+{
+    return _elseStmt != nullptr && _thenStmt->returns() && _elseStmt->returns();
+}
+
+
+/*
+ * Function:	Assignment::simplify
+ *
+ * Description:	Simplify an assignment statement.  An assignment to a local
+ *		variable that is never read is removed, but the right-hand
+ *		side must still be evaluated if it contains a call.
+ */
+
+Statement *Assignment::simplify()
+{
+    const Symbol *symbol;
+
+
+    _left = _left->fold();
+    _right = _right->fold();
+
+    if (pruning && _left->isIdentifier(symbol))
+	if (locals.count(symbol) > 0 && used.count(symbol) == 0) {
+	    eliminated ++;
+	    return _right->_hasCall ? new Simple(_right) : nullptr;
+	}
+
+    return this;
+}
+
+
+/*
+ * Function:	Return::simplify
+ *
+ * Description:	Simplify a return statement.
+ */
+
+Statement *Return::simplify()
+{
+    _expr = _expr->fold();
+    return this;
+}
+
+
+/*
+ * Function:	Block::simplify
+ *
+ * Description:	Simplify a block by simplifying each of its statements.
+ *		Any statements following one that always returns are
+ *		unreachable and removed.  We also note the symbols declared
+ *		in the block as being local variables.
+ */
+
+Statement *Block::simplify()
+{
+    Statements stmts;
+
+
+    for (auto symbol : _decls->symbols())
+	locals.insert(symbol);
+
+    for (unsigned i = 0; i < _stmts.size(); i ++) {
+	Statement *stmt = _stmts[i]->simplify();
+
+	if (stmt != nullptr) {
+	    stmts.push_back(stmt);
+
+	    if (stmt->returns()) {
+		eliminated += _stmts.size() - i - 1;
+		break;
+	    }
+	}
+    }
+
+    _stmts = stmts;
+    return this;
+}
+
+
+/*
+ * Function:	While::simplify
+ *
+ * Description:	Simplify a while statement, removing it entirely if its
+ *		condition is always false.
+ */
+
+Statement *While::simplify()
+{
+    unsigned value;
+
+
+    _expr = _expr->fold();
+    _stmt = nonempty(_stmt->simplify());
+
+    if (_expr->isNumber(value) && value == 0) {
+	eliminated ++;
+	return nullptr;
+    }
+
+    return this;
+}
+
+
+/*
+ * Function:	For::simplify
+ *
+ * Description:	Simplify a for statement, leaving only its initialization
+ *		if its condition is always false.
+ */
+
+Statement *For::simplify()
+{
+    unsigned value;
+
+
+    _init = nonempty(_init->simplify());
+    _expr = _expr->fold();
+    _incr = nonempty(_incr->simplify());
+    _stmt = nonempty(_stmt->simplify());
+
+    if (_expr->isNumber(value) && value == 0) {
+	eliminated ++;
+	return _init;
+    }
+
+    return this;
+}
+
+
+/*
+ * Function:	If::simplify
+ *
+ * Description:	Simplify an if-then or if-then-else statement, keeping only
+ *		the branch taken if its condition is a constant.
+ */
+
+Statement *If::simplify()
+{
+    unsigned value;
+
+
+    _expr = _expr->fold();
+    _thenStmt = nonempty(_thenStmt->simplify());
+
+    if (_elseStmt != nullptr)
+	_elseStmt = _elseStmt->simplify();
+
+    if (_expr->isNumber(value)) {
+	eliminated ++;
+	return value != 0 ? _thenStmt : _elseStmt;
+    }
+
+    return this;
+}
+
+
+/*
+ * Function:	Simple::simplify
+ *
+ * Description:	Simplify an expression statement, removing it entirely if
+ *		evaluating the expression has no effect.
+ */
+
+Statement *Simple::simplify()
+{
+    _expr = _expr->fold();
+
+    if (!_expr->_hasCall) {
+	eliminated ++;
+	return nullptr;
+    }
+
+    return this;
+}
+
+
+/*
+ * Function:	Function::simplify
+ *
+ * Description:	Simplify the body of a function.  After the first pass has
+ *		folded constants and removed unreachable statements, we
+ *		repeatedly mark which symbols are read and remove the
+ *		assignments to local variables that are not, since doing so
+ *		may leave other variables unread.  The last marking also
+ *		tells us whether the address of a local variable is taken.
+ */
+
+void Function::simplify()
+{
+    unsigned count;
+    PhaseTimer timer(OPTIMIZING);
+
+
+    locals.clear();
+    eliminated = 0;
+
+    _body->simplify();
+    pruning = true;
+
+    do {
+	count = eliminated;
+	used.clear();
+	addressed.clear();
+	_body->mark();
+	_body->simplify();
+    } while (eliminated != count);
+
+    pruning = false;
+    _addressed = false;
+
+    for (auto symbol : addressed)
+	if (locals.count(symbol) > 0)
+	    _addressed = true;
+
+    if (opt_report)
+	*diagnostics << _id->name() << ": " << eliminated << " statements eliminated" << endl;
+}
@@ -0,0 +1,289 @@
+/*
+ * File:	options.cpp
+ *
+ * Description:	This file contains the definitions for the command-line
+ *		options accepted by the Simple C compiler.  Unless files are
+ *		named, the source program is read from the standard input
+ *		and the assembly code is written to the standard output.
+ *		Each file named is compiled separately, with its assembly
+ *		code written to a file ending in .s instead of .c.
+ *
+ *		-c		writing an ELF32 relocatable object file
+ *				rather than assembly code, ending in .o
+ *				if files are named
+ *		--run		loading the code into memory and running
+ *				it at once, with the program reading the
+ *				standard input if a file is named
+ *		--interp	encoding the program as bytecode and
+ *				interpreting it at once, with pointers as
+ *				wide as those of the host
+ *
+ *		-m32		generating code for the Intel 32-bit
+ *				processor (the default)
+ *		-m64		generating code for x86-64, passing
+ *				arguments as the System V ABI does
+ *
+ *		-O0		no optimization (the default)
+ *		-O, -O1		simplifying the tree, inlining calls to small
+ *				leaf functions, tail calls, and local
+ *				optimizations
+ *
+ *		-fomit-frame-pointer	addressing the frame relative to
+ *				%esp rather than %ebp, and omitting the
+ *				frame entirely if it is empty
+ *		-fno-omit-frame-pointer	using %ebp (the default)
+ *
+ *		-freorder-blocks	rotating loops and laying out if
+ *				statements for the likely path when
+ *				optimizing or using a profile (the default)
+ *		-fno-reorder-blocks	laying out code as it is written
+ *
+ *		-fthread-jumps	branching on conditions directly, and
+ *				forwarding and removing redundant branches
+ *				when optimizing (the default)
+ *		-fno-thread-jumps	branching as the code is written
+ *
+ *		-fcodegen-threads=N	generating code for the functions
+ *				using N threads (the default is one)
+ *		-fpipeline	lexing, parsing, and generating code on
+ *				separate threads at the same time
+ *
+ *		-fcache=DIR	reusing the code generated for a function
+ *				in an earlier compilation, kept in DIR
+ *
+ *		-fincremental=FILE
+ *				recompiling only the functions changed
+ *				since the compilation recorded in FILE
+ *
+ *		-fprofile-generate[=FILE]
+ *				counting how often each function, if
+ *				statement, and loop is run, with the
+ *				program writing the counts to FILE
+ *				(scc.prof by default) when it exits, so
+ *				the program must be a single file
+ *				defining main
+ *		-fprofile-use[=FILE]
+ *				laying out branches, keeping values across
+ *				calls, and inlining according to the counts
+ *				in FILE (scc.prof by default)
+ *
+ *		-ftime-report	reporting the time spent in each phase
+ *				and counts of what was done to the standard
+ *				error once compilation is finished
+ *		-ftime-report=json
+ *				reporting the same as a single line of JSON
+ *		-fopt-report	reporting what was optimized in each
+ *				function, and how many functions were
+ *				reused from the cache or the snapshot, to
+ *				the standard error
+ *
+ *		-j N		compiling up to N of the files named at once
+ *		-o DIR		writing the assembly files into DIR
+ *
+ *		--server PATH	running as a compile server listening on
+ *				the Unix socket PATH (-j N serves up to N
+ *				requests at once)
+ */
+
+# include <cstdlib>
+# include <cstring>
+# include <iostream>
+# include "options.h"
+
+using namespace std;
+
+int optimize;
+bool omit_frame_pointer;
+bool reorder_blocks = true;
+bool thread_jumps = true;
+unsigned codegen_threads = 1;
+bool pipeline;
+unsigned jobs = 1;
+string outdir;
+vector<string> files;
+string server;
+string cachedir;
+string snapshot;
+string profile_generate, profile_use;
+bool time_report, time_report_json;
+bool opt_report;
+bool object;
+bool jit;
+bool interp;
+bool m64;
+
+
+/*
+ * Function:	usage (private)
+ *
+ * Description:	Report an invalid option to the standard error and exit.
+ */
+
+static void usage(const char *arg)
+{
+    cerr << "scc: unrecognized option '" << arg << "'" << endl;
+    cerr << "usage: scc [-c] [-m32|-m64] [-O0|-O1] [-f[no-]omit-frame-pointer]";
+    cerr << " [-f[no-]reorder-blocks] [-f[no-]thread-jumps]";
+    cerr << " [-fcodegen-threads=N] [-fpipeline] [-fcache=DIR]";
+    cerr << " [-fincremental=FILE] [-fprofile-generate[=FILE]]";
+    cerr << " [-fprofile-use[=FILE]] [-ftime-report[=json]] [-fopt-report]";
+    cerr << " < file.c > file.s" << endl;
+    cerr << "       scc [options] [-j N] [-o DIR] file.c ..." << endl;
+    cerr << "       scc [options] [-j N] --server PATH" << endl;
+    cerr << "       scc [options] --run [file.c]" << endl;
+    cerr << "       scc [options] --interp [file.c]" << endl;
+    exit(EXIT_FAILURE);
+}
+
+
+/*
+ * Function:	parseOptions
+ *
+ * Description:	Parse the command-line options.
+ */
+
+void parseOptions(int argc, char *argv[])
+{
+    char *end;
+
+    for (int i = 1; i < argc; i ++) {
+	if (strcmp(argv[i], "-O") == 0 || strcmp(argv[i], "-O1") == 0)
+	    optimize = 1;
+	else if (strcmp(argv[i], "-O0") == 0)
+	    optimize = 0;
+	else if (strcmp(argv[i], "-c") == 0)
+	    object = true;
+	else if (strcmp(argv[i], "-m32") == 0)
+	    m64 = false;
+	else if (strcmp(argv[i], "-m64") == 0)
+	    m64 = true;
+	else if (strcmp(argv[i], "-fomit-frame-pointer") == 0)
+	    omit_frame_pointer = true;
+	else if (strcmp(argv[i], "-fno-omit-frame-pointer") == 0)
+	    omit_frame_pointer = false;
+	else if (strcmp(argv[i], "-freorder-blocks") == 0)
+	    reorder_blocks = true;
+	else if (strcmp(argv[i], "-fno-reorder-blocks") == 0)
+	    reorder_blocks = false;
+	else if (strcmp(argv[i], "-fthread-jumps") == 0)
+	    thread_jumps = true;
+	else if (strcmp(argv[i], "-fno-thread-jumps") == 0)
+	    thread_jumps = false;
+	else if (strcmp(argv[i], "-fpipeline") == 0)
+	    pipeline = true;
+	else if (strcmp(argv[i], "-ftime-report") == 0)
+	    time_report = true;
+	else if (strcmp(argv[i], "-ftime-report=json") == 0)
+	    time_report = time_report_json = true;
+	else if (strcmp(argv[i], "-fopt-report") == 0)
+	    opt_report = true;
+	else if (strncmp(argv[i], "-fcache=", 8) == 0 && argv[i][8] != '\0')
+	    cachedir = argv[i] + 8;
+	else if (strncmp(argv[i], "-fincremental=", 14) == 0 && argv[i][14] != '\0')
+	    snapshot = argv[i] + 14;
+	else if (strcmp(argv[i], "-fprofile-generate") == 0)
+	    profile_generate = "scc.prof";
+	else if (strncmp(argv[i], "-fprofile-generate=", 19) == 0 && argv[i][19] != '\0')
+	    profile_generate = argv[i] + 19;
+	else if (strcmp(argv[i], "-fprofile-use") == 0)
+	    profile_use = "scc.prof";
+	else if (strncmp(argv[i], "-fprofile-use=", 14) == 0 && argv[i][14] != '\0')
+	    profile_use = argv[i] + 14;
+	else if (strncmp(argv[i], "-fcodegen-threads=", 18) == 0) {
+	    codegen_threads = strtoul(argv[i] + 18, &end, 10);
+
+	    if (*end != '\0' || codegen_threads == 0)
+		usage(argv[i]);
+	} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+	    jobs = strtoul(argv[++ i], &end, 10);
+
+	    if (*end != '\0' || jobs == 0)
+		usage(argv[i]);
+	} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+	    outdir = argv[++ i];
+	else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc)
+	    server = argv[++ i];
+	else if (strcmp(argv[i], "--run") == 0)
+	    jit = true;
+	else if (strcmp(argv[i], "--interp") == 0)
+	    interp = true;
+	else if (argv[i][0] != '-')
+	    files.push_back(argv[i]);
+	else
+	    usage(argv[i]);
+    }
+
+    if (pipeline && (!files.empty() || !server.empty())) {
+	cerr << "scc: -fpipeline cannot be used with files or --server" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if (pipeline && (!cachedir.empty() || !snapshot.empty())) {
+	cerr << "scc: -fpipeline cannot be used with -fcache or -fincremental" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if (jit && (object || !server.empty() || files.size() > 1)) {
+	cerr << "scc: --run cannot be used with -c, --server, or several files" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if (m64 && (object || jit)) {
+	cerr << "scc: -m64 cannot be used with -c or --run" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if (interp && (object || jit || pipeline || !server.empty() || files.size() > 1)) {
+	cerr << "scc: --interp cannot be used with -c, --run, -fpipeline, --server, or several files" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if (interp)
+	m64 = sizeof(void *) == 8;
+
+    if (object && !server.empty()) {
+	cerr << "scc: -c cannot be used with --server" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if (!snapshot.empty() && (!files.empty() || !server.empty())) {
+	cerr << "scc: -fincremental cannot be used with files or --server" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if ((!profile_generate.empty() || !profile_use.empty()) && (object || jit
+	    || interp || pipeline || !cachedir.empty() || !snapshot.empty()
+	    || !server.empty() || files.size() > 1)) {
+	cerr << "scc: -fprofile-generate and -fprofile-use cannot be used with";
+	cerr << " -c, --run, --interp, -fpipeline, -fcache, -fincremental,";
+	cerr << " --server, or several files" << endl;
+	exit(EXIT_FAILURE);
+    }
+}
+
+
+/*
+ * Function:	codegenOptions
+ *
+ * Description:	Return the options that affect the code generated, for
+ *		recording along with code to be reused later.
+ */
+
+string codegenOptions()
+{
+    string result = "-O" + to_string(optimize);
+
+    if (omit_frame_pointer)
+	result += " -fomit-frame-pointer";
+
+    if (!reorder_blocks)
+	result += " -fno-reorder-blocks";
+
+    if (!thread_jumps)
+	result += " -fno-thread-jumps";
+
+    if (m64)
+	result += " -m64";
+
+    return result;
+}
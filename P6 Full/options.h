@@ -0,0 +1,36 @@
+/*
+ * File:	options.h
+ *
+ * Description:	This file contains the declarations for the command-line
+ *		options accepted by the Simple C compiler.
+ */
+
+# ifndef OPTIONS_H
+# define OPTIONS_H
+# include <string>
+# include <vector>
+
+extern int optimize;
+extern bool omit_frame_pointer;
+extern bool reorder_blocks;
+extern bool thread_jumps;
+extern unsigned codegen_threads;
+extern bool pipeline;
+extern unsigned jobs;
+extern std::string outdir;
+extern std::vector<std::string> files;
+extern std::string server;
+extern std::string cachedir;
+extern std::string snapshot;
+extern std::string profile_generate, profile_use;
+extern bool time_report, time_report_json;
+extern bool opt_report;
+extern bool object;
+extern bool jit;
+extern bool interp;
+extern bool m64;
+
+void parseOptions(int argc, char *argv[]);
+std::string codegenOptions();
+
+# endif /* OPTIONS_H */
@@ -6,28 +6,41 @@
  *		Simple C.
  */
 
-# include <cstdlib>
+# include <sstream>
 # include <iostream>
+# include <iterator>
 # include "generator.h"
+# include "interpreter.h"
+# include "incremental.h"
+# include "inliner.h"
+# include "pipeline.h"
+# include "profile.h"
+# include "parser.h"
 # include "checker.h"
 # include "string.h"
 # include "tokens.h"
 # include "lexer.h"
+# include "options.h"
+# include "timing.h"
 
 using namespace std;
 
-static int lookahead;
-static string lexbuf;
+class SyntaxError {};
+
+static thread_local int lookahead;
+static thread_local string lexbuf;
+static thread_local Functions functions;
 
 static Expression *expression();
 static Statement *statement();
-static Type returnType;
+static thread_local Type returnType;
 
 
 /*
  * Function:	error
  *
- * Description:	Report a syntax error to standard error.
+ * Description:	Report a syntax error to standard error and abandon the
+ *		translation unit.
  */
 
 static void error()
@@ -37,7 +50,7 @@ static void error()
     else
 	report("syntax error at '%s'", lexbuf);
 
-    exit(EXIT_FAILURE);
+    throw SyntaxError();
 }
 
 
@@ -54,7 +67,7 @@ static void match(int t)
     if (lookahead != t)
 	error();
 
-    lookahead = lexan(lexbuf);
+    lookahead = nextToken(lexbuf);
 }
 
 
@@ -681,6 +694,7 @@ static Statement *statement()
     Expression *expr;
     Statement *stmt, *init, *incr;
     Statements stmts;
+    unsigned counter;
 
 
     if (lookahead == '{') {
@@ -703,16 +717,18 @@ static Statement *statement()
 
     if (lookahead == WHILE) {
 	match(WHILE);
+	counter = newCounters(2);
 	match('(');
 	expr = expression();
 	checkTest(expr);
 	match(')');
 	stmt = statement();
-	return new While(expr, stmt);
+	return new While(expr, stmt, counter);
     }
 
     if (lookahead == FOR) {
 	match(FOR);
+	counter = newCounters(2);
 	match('(');
 	init = assignment();
 	match(';');
@@ -722,11 +738,12 @@ static Statement *statement()
 	incr = assignment();
 	match(')');
 	stmt = statement();
-	return new For(init, expr, incr, stmt);
+	return new For(init, expr, incr, stmt, counter);
     }
 
     if (lookahead == IF) {
 	match(IF);
+	counter = newCounters(2);
 	match('(');
 	expr = expression();
 	checkTest(expr);
@@ -734,10 +751,10 @@ static Statement *statement()
 	stmt = statement();
 
 	if (lookahead != ELSE)
-	    return new If(expr, stmt, nullptr);
+	    return new If(expr, stmt, nullptr, counter);
 
 	match(ELSE);
-	return new If(expr, stmt, statement());
+	return new If(expr, stmt, statement(), counter);
     }
 
     stmt = assignment();
@@ -901,12 +918,13 @@ static void remainingDeclarators(int typespec)
 static void globalOrFunction()
 {
     int typespec;
-    unsigned indirection;
+    unsigned indirection, counter;
     string name;
     Statements stmts;
     Function *function;
     Symbol *symbol;
     Scope *decls;
+    PhaseTimer timer(PARSING);
 
 
     typespec = specifier();
@@ -933,14 +951,18 @@ static void globalOrFunction()
 	    symbol = defineFunction(name, Type(typespec, indirection, parameters()));
 	    match(')');
 	    match('{');
+	    counter = newCounters(1);
 	    declarations();
 	    stmts = statements();
 	    decls = closeScope();
-	    function = new Function(symbol, new Block(decls, stmts));
-	    match('}');
+	    function = new Function(symbol, new Block(decls, stmts), counter);
+
+	    if (!pipeline)
+		functions.push_back(function);
+	    else if (numerrors == 0)
+		schedule(function);
 
-	    if (numerrors == 0)
-		function->generate();
+	    match('}');
 	}
 
     } else {
@@ -951,19 +973,101 @@ static void globalOrFunction()
 
 
 /*
- * Function:	main
+ * Function:	translate
  *
- * Description:	Analyze the standard input stream.
+ * Description:	Translate a single translation unit read from the given
+ *		input stream, writing its assembly code to the given output
+ *		stream.  The functions are kept until the entire unit has
+ *		been parsed so that calls to functions defined later may be
+ *		inlined, unless we are running as a pipeline.  When
+ *		recompiling incrementally, we parse the source as rewritten
+ *		to leave out the bodies of functions that can be reused.
+ *		A program being profiled is not inlined, so that each call
+ *		is counted, and must be a single unit defining main, since
+ *		the counters are written by main.  Return false if there
+ *		were any errors, or if the unit was abandoned because of a
+ *		syntax error.
  */
 
-int main()
+bool translate(istream &in, ostream &out)
 {
+    stringstream rewritten;
+    Scope *globals;
+    bool found;
+
+
+    numerrors = 0;
+    functions.clear();
+    clearCounters();
     openScope();
-    lookahead = lexan(lexbuf);
 
-    while (lookahead != DONE)
-	globalOrFunction();
+    if (pipeline)
+	startPipeline(in, out);
+    else if (!snapshot.empty()) {
+	rewritten.str(prepare(string(istreambuf_iterator<char>(in), istreambuf_iterator<char>())));
+	setInput(rewritten);
+    } else
+	setInput(in);
+
+    try {
+	lookahead = nextToken(lexbuf);
+
+	while (lookahead != DONE)
+	    globalOrFunction();
+
+    } catch (const SyntaxError &) {
+	if (pipeline)
+	    finishPipeline();
+
+	while (closeScope()->enclosing() != nullptr)
+	    continue;
 
-    generateGlobals(closeScope());
-    exit(EXIT_SUCCESS);
+	return false;
+    }
+
+    globals = closeScope();
+
+    if (pipeline) {
+	finishPipeline(globals);
+	return numerrors == 0;
+    }
+
+    if (!profile_generate.empty() && numerrors == 0) {
+	found = false;
+
+	for (auto function : functions)
+	    found = found || function->id()->name() == "main";
+
+	if (!found) {
+	    *diagnostics << "scc: -fprofile-generate requires a program in a";
+	    *diagnostics << " single file defining main" << endl;
+	    numerrors ++;
+	}
+    }
+
+    if (numerrors == 0) {
+	if (!profile_use.empty())
+	    readProfile(profile_use);
+
+	if (optimize > 0) {
+	    for (auto function : functions)
+		function->simplify();
+
+	    if (profile_generate.empty())
+		inlineCalls(functions);
+	}
+
+	if (interp)
+	    encodeFunctions(functions, globals);
+	else
+	    generateFunctions(functions, globals, codegen_threads, out);
+    }
+
+    generateGlobals(globals, out);
+
+    if (!snapshot.empty() && numerrors == 0)
+	saveSnapshot();
+
+    return numerrors == 0;
 }
+
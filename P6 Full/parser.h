@@ -0,0 +1,15 @@
+/*
+ * File:	parser.h
+ *
+ * Description:	This file contains the function declarations for the
+ *		recursive-descent parser for Simple C.
+ */
+
+# ifndef PARSER_H
+# define PARSER_H
+# include <istream>
+# include <ostream>
+
+bool translate(std::istream &in, std::ostream &out);
+
+# endif /* PARSER_H */
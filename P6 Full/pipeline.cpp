@@ -0,0 +1,263 @@
+/*
+ * File:	pipeline.cpp
+ *
+ * Description:	This file contains the public and private function and
+ *		variable definitions for running the lexer, parser, and
+ *		code generator for Simple C as a pipeline, each stage on
+ *		its own thread.
+ *
+ *		The lexer thread writes tokens into a ring buffer, from
+ *		which the parser reads them.  Since the ring has exactly
+ *		one writer and one reader, it needs no lock: each side only
+ *		advances its own index.  The lexemes are interned, so a
+ *		token carries only a pointer to its lexeme.  The parser
+ *		hands each function to the code generator thread as soon
+ *		as it has been parsed.
+ *
+ *		Since functions are generated as they arrive, calls may
+ *		only be inlined to functions defined earlier.  Whatever the
+ *		lexer and code generator threads report is kept until the
+ *		pipeline is finished and then written to the diagnostic
+ *		stream of the parser, which no other thread may write.
+ */
+
+# include <deque>
+# include <sstream>
+# include <mutex>
+# include <atomic>
+# include <thread>
+# include <unordered_set>
+# include <condition_variable>
+# include "generator.h"
+# include "pipeline.h"
+# include "inliner.h"
+# include "options.h"
+# include "tokens.h"
+# include "lexer.h"
+# include "storage.h"
+
+using namespace std;
+
+struct Token {
+    int type;
+    const string *lexeme;
+    int lineno, numerrors;
+};
+
+static const unsigned ring_size = 4096;
+
+static bool pipelined, done;
+static istream *source;
+static ostream *sink;
+static Scope *globals;
+static Storage *storage;
+static stringstream lexnotes, gennotes;
+static Token ring[ring_size];
+static atomic<unsigned> head, tail;
+static atomic<bool> stopped;
+static int lexerrors;
+static unordered_set<string> lexemes;
+static thread lexer, generator;
+
+static mutex queuelock;
+static condition_variable ready;
+static deque<Function *> queue;
+static bool finished;
+
+
+/*
+ * Function:	produce (private)
+ *
+ * Description:	Read tokens from the standard input and write them into
+ *		the ring buffer, waiting while the ring is full.  Each
+ *		token remembers its line number, which is used by the
+ *		parser when reporting errors, and how many errors the lexer
+ *		has reported so far.  We stop early if the parser stops
+ *		reading.
+ */
+
+static void produce()
+{
+    string lexbuf;
+    Token token;
+    unsigned next;
+
+
+    next = 0;
+    diagnostics = &lexnotes;
+    setInput(*source);
+
+    do {
+	token.type = lexan(lexbuf);
+	token.lexeme = &*lexemes.insert(lexbuf).first;
+	token.lineno = lineno;
+	token.numerrors = numerrors;
+
+	while (next - head.load(memory_order_acquire) == ring_size) {
+	    if (stopped)
+		return;
+
+	    this_thread::yield();
+	}
+
+	ring[next % ring_size] = token;
+	tail.store(++ next, memory_order_release);
+    } while (token.type != DONE);
+}
+
+
+/*
+ * Function:	consume (private)
+ *
+ * Description:	Generate code for each function handed to us by the
+ *		parser, until the parser has finished, and then for the
+ *		global variables and string literals if it succeeded.
+ *		Anything allocated here belongs to the compilation of the
+ *		parser.
+ */
+
+static void consume()
+{
+    Function *function;
+
+
+    useStorage(storage);
+    diagnostics = &gennotes;
+
+    while (true) {
+	{
+	    unique_lock<mutex> guard(queuelock);
+
+	    ready.wait(guard, [] { return !queue.empty() || finished; });
+
+	    if (queue.empty())
+		break;
+
+	    function = queue.front();
+	    queue.pop_front();
+	}
+
+	if (optimize > 0) {
+	    function->simplify();
+	    inlineCalls(function);
+	}
+
+	generateFunctions(Functions(1, function), nullptr, 1, *sink);
+    }
+
+    if (globals != nullptr)
+	generateGlobals(globals, *sink);
+}
+
+
+/*
+ * Function:	startPipeline
+ *
+ * Description:	Start the lexer and code generator threads, reading from
+ *		and writing to the given streams.  Nothing is left over
+ *		from any earlier pipeline in this process.
+ */
+
+void startPipeline(istream &in, ostream &out)
+{
+    head = tail = 0;
+    stopped = false;
+    done = false;
+    lexerrors = 0;
+    lexemes.clear();
+    globals = nullptr;
+    queue.clear();
+    finished = false;
+    lexnotes.str("");
+    gennotes.str("");
+
+    pipelined = true;
+    storage = currentStorage();
+    source = &in;
+    sink = &out;
+    lexer = thread(produce);
+    generator = thread(consume);
+}
+
+
+/*
+ * Function:	nextToken
+ *
+ * Description:	Return the next token, either read from the ring buffer
+ *		if we are running as a pipeline, or directly from the
+ *		lexer.  Once the end of input has been seen, it is
+ *		returned without reading any further.  Any errors reported
+ *		by the lexer thread are counted as our own.
+ */
+
+int nextToken(string &lexbuf)
+{
+    Token token;
+    unsigned next;
+
+
+    if (!pipelined)
+	return lexan(lexbuf);
+
+    if (done)
+	return DONE;
+
+    next = head.load(memory_order_relaxed);
+
+    while (next == tail.load(memory_order_acquire))
+	this_thread::yield();
+
+    token = ring[next % ring_size];
+    head.store(next + 1, memory_order_release);
+
+    lexbuf = *token.lexeme;
+    lineno = token.lineno;
+    numerrors += token.numerrors - lexerrors;
+    lexerrors = token.numerrors;
+    done = token.type == DONE;
+    return token.type;
+}
+
+
+/*
+ * Function:	schedule
+ *
+ * Description:	Hand a function to the code generator thread.
+ */
+
+void schedule(Function *function)
+{
+    lock_guard<mutex> guard(queuelock);
+
+    queue.push_back(function);
+    ready.notify_one();
+}
+
+
+/*
+ * Function:	finishPipeline
+ *
+ * Description:	Wait for the lexer and code generator threads to finish,
+ *		which must be done before exiting, even after an error,
+ *		and then write whatever they reported.  The global scope
+ *		is given only if parsing succeeded.
+ */
+
+void finishPipeline(Scope *scope)
+{
+    stopped = true;
+
+    {
+	lock_guard<mutex> guard(queuelock);
+
+	globals = scope;
+	finished = true;
+	ready.notify_one();
+    }
+
+    lexer.join();
+    generator.join();
+    pipelined = false;
+
+    *diagnostics << lexnotes.str() << gennotes.str();
+}
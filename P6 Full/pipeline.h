@@ -0,0 +1,21 @@
+/*
+ * File:	pipeline.h
+ *
+ * Description:	This file contains the function declarations for running
+ *		the lexer, parser, and code generator for Simple C as a
+ *		pipeline, each stage on its own thread.
+ */
+
+# ifndef PIPELINE_H
+# define PIPELINE_H
+# include <string>
+# include <istream>
+# include <ostream>
+# include "Tree.h"
+
+void startPipeline(std::istream &in, std::ostream &out);
+int nextToken(std::string &lexbuf);
+void schedule(Function *function);
+void finishPipeline(Scope *scope = nullptr);
+
+# endif /* PIPELINE_H */
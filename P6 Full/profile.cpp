@@ -0,0 +1,135 @@
+/*
+ * File:	profile.cpp
+ *
+ * Description:	This file contains the public function definitions for
+ *		the counters used to profile a program and for reading back
+ *		the counts a profiled program has written.
+ *
+ *		The parser gives each function one counter, for the
+ *		number of times it is called, and each if statement and
+ *		loop two: one for the number of times the statement is run,
+ *		and one for the number of times the then part or the body
+ *		is run.  The counters are numbered in the order in which
+ *		the statements appear in the source, so the numbering is
+ *		the same whenever the same source is compiled, however the
+ *		tree is later optimized.  An inlined copy of a statement
+ *		keeps the counters of the original.
+ *
+ *		A profiled program writes its counters when it exits as an
+ *		array of 64-bit integers, least significant byte first.  A
+ *		profile with the wrong number of counters was written by a
+ *		different program, so it is ignored.
+ */
+
+# include <vector>
+# include <fstream>
+# include <iostream>
+# include "profile.h"
+# include "lexer.h"
+
+using namespace std;
+
+static thread_local unsigned counters;
+static vector<unsigned long> frequencies;
+
+
+/*
+ * Function:	clearCounters
+ *
+ * Description:	Forget the counters given out, before parsing another
+ *		translation unit.
+ */
+
+void clearCounters()
+{
+    counters = 0;
+}
+
+
+/*
+ * Function:	newCounters
+ *
+ * Description:	Give out the given number of consecutive counters,
+ *		returning the number of the first.
+ */
+
+unsigned newCounters(unsigned n)
+{
+    counters += n;
+    return counters - n;
+}
+
+
+/*
+ * Function:	numCounters
+ *
+ * Description:	Return the number of counters given out.
+ */
+
+unsigned numCounters()
+{
+    return counters;
+}
+
+
+/*
+ * Function:	readProfile
+ *
+ * Description:	Read the counts in the profile at the given path, which
+ *		must have been written by the program being compiled.  If
+ *		it cannot be used, we compile as if there were none.
+ */
+
+void readProfile(const string &path)
+{
+    ifstream in(path, ios::binary);
+    unsigned char bytes[8];
+    unsigned long value;
+
+
+    frequencies.clear();
+
+    if (!in) {
+	*diagnostics << "scc: warning: cannot read profile '" << path << "'" << endl;
+	return;
+    }
+
+    while (in.read((char *) bytes, sizeof(bytes))) {
+	value = 0;
+
+	for (unsigned i = sizeof(bytes); i > 0; i --)
+	    value = value << 8 | bytes[i - 1];
+
+	frequencies.push_back(value);
+    }
+
+    if (frequencies.size() != counters || in.gcount() != 0) {
+	*diagnostics << "scc: warning: profile '" << path << "' does not match the program" << endl;
+	frequencies.clear();
+    }
+}
+
+
+/*
+ * Function:	profiled
+ *
+ * Description:	Return whether a profile is being used.
+ */
+
+bool profiled()
+{
+    return !frequencies.empty();
+}
+
+
+/*
+ * Function:	frequency
+ *
+ * Description:	Return the count of the given counter in the profile,
+ *		which is zero if there is no profile.
+ */
+
+unsigned long frequency(unsigned counter)
+{
+    return counter < frequencies.size() ? frequencies[counter] : 0;
+}
@@ -0,0 +1,20 @@
+/*
+ * File:	profile.h
+ *
+ * Description:	This file contains the function declarations for the
+ *		counters used to profile a program and for reading back the
+ *		counts a profiled program has written.
+ */
+
+# ifndef PROFILE_H
+# define PROFILE_H
+# include <string>
+
+void clearCounters();
+unsigned newCounters(unsigned n);
+unsigned numCounters();
+void readProfile(const std::string &path);
+bool profiled();
+unsigned long frequency(unsigned counter);
+
+# endif /* PROFILE_H */
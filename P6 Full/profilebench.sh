@@ -0,0 +1,98 @@
+#!/bin/sh
+#
+# profilebench.sh - measure what a profile gains for the code scc generates
+#
+# Each program given (qsort by default) is compiled by scc -m64 -O three
+# times: as usual, with -fprofile-generate, and with -fprofile-use after
+# the instrumented program has been run on its input to write a
+# profile.  The output of each build must match the expected output in
+# the examples directory, and the instrumented build must have written
+# a profile that scc accepts.  Each build is then run several times,
+# keeping the fastest run.  The table is also written to
+# profilebench.log.
+#
+# usage: profilebench.sh [program ...]
+#
+
+SCC=./scc
+DIR=examples
+LOG=profilebench.log
+RUNS=${RUNS:-5}
+WORKDIR=${TMPDIR:-/tmp}/scc-profilebench.$$
+
+trap 'rm -rf $WORKDIR' 0
+trap 'exit 1' 1 2 15
+mkdir -p $WORKDIR || exit 1
+
+programs=${*:-qsort}
+status=0
+
+
+# Run the given executable several times with the input of the given
+# program, printing the time of the fastest run in milliseconds.
+
+measure() {
+    program=$1
+    best=
+    run=0
+
+    while [ $run -lt $RUNS ]; do
+	start=`date +%s%N`
+	$2 < $DIR/$program.in > /dev/null 2>&1
+	stop=`date +%s%N`
+	time=`expr \( $stop - $start \) / 1000000`
+
+	if [ -z "$best" ] || [ $time -lt $best ]; then
+	    best=$time
+	fi
+
+	run=`expr $run + 1`
+    done
+
+    echo $best
+}
+
+
+# Compile the given program with the given options into the given
+# executable and check its output, returning false if either fails.
+
+build() {
+    program=$1
+    executable=$2
+    shift 2
+
+    $SCC -m64 -O "$@" < $DIR/$program.c > $WORKDIR/a.s 2> $WORKDIR/errors ||
+	return 1
+
+    if grep 'scc: warning' $WORKDIR/errors 1>&2; then
+	return 1
+    fi
+
+    gcc -o $executable $WORKDIR/a.s 2> /dev/null || return 1
+    $executable < $DIR/$program.in > $WORKDIR/output 2> /dev/null
+    cmp -s $WORKDIR/output $DIR/$program.out
+}
+
+
+printf "%-8s %10s %14s %12s\n" program "-O ms" "generate ms" "use ms" | tee $LOG
+
+for program in $programs; do
+    profile=$WORKDIR/$program.prof
+    rm -f $profile
+
+    if ! build $program $WORKDIR/plain ||
+	! build $program $WORKDIR/generate -fprofile-generate=$profile ||
+	! test -s $profile ||
+	! build $program $WORKDIR/use -fprofile-use=$profile; then
+	echo "$program: profiled build failed or differs" 1>&2
+	status=1
+	continue
+    fi
+
+    plain=`measure $program $WORKDIR/plain`
+    generate=`measure $program $WORKDIR/generate`
+    use=`measure $program $WORKDIR/use`
+    printf "%-8s %10s %14s %12s\n" $program $plain $generate $use | tee -a $LOG
+done
+
+exit $status
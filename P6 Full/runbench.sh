@@ -0,0 +1,112 @@
+#!/bin/sh
+#
+# runbench.sh - measure how fast the code generated by scc runs
+#
+# Each program in the benchmarks directory is compiled by scc at each
+# optimization level, assembled and linked with gcc -m32, and run on its
+# input several times, keeping the fastest run.  The same program compiled
+# by gcc -m32 -O0 is the reference: its output must match, and the time
+# of each run is also given relative to it.  If perf is available, the
+# cycles, instructions, and branch misses of the fastest run are counted
+# as well.  The table is also written to runbench.log.
+#
+# usage: runbench.sh [program ...]
+#
+
+SCC=./scc
+DIR=benchmarks
+LOG=runbench.log
+RUNS=${RUNS:-3}
+WORKDIR=${TMPDIR:-/tmp}/scc-runbench.$$
+
+LEVELS="-O0 -O1"
+
+trap 'rm -rf $WORKDIR' 0
+trap 'exit 1' 1 2 15
+mkdir -p $WORKDIR || exit 1
+
+if perf stat -e cycles true > /dev/null 2>&1; then
+    PERF="perf stat -x, -e cycles,instructions,branch-misses -o $WORKDIR/perf"
+else
+    PERF=
+fi
+
+programs=${*:-`cd $DIR && ls *.c | sed 's/\.c$//'`}
+
+
+# Build the given program with the given compiler and options into
+# $WORKDIR/a.out, returning whether it succeeded.
+
+build() {
+    program=$1
+    compiler=$2
+    shift 2
+
+    if [ $compiler = gcc ]; then
+	gcc -m32 -w "$@" -o $WORKDIR/a.out $DIR/$program.c
+    else
+	$SCC "$@" < $DIR/$program.c > $WORKDIR/a.s 2> /dev/null &&
+	    gcc -m32 -o $WORKDIR/a.out $WORKDIR/a.s
+    fi
+}
+
+
+# Run the program built several times, printing the time of the fastest
+# run in milliseconds and its counts, or a dash for each count missing.
+# The output of every run is kept in $WORKDIR/output.
+
+measure() {
+    program=$1
+    best=
+    run=0
+
+    while [ $run -lt $RUNS ]; do
+	start=`date +%s%N`
+	$PERF $WORKDIR/a.out < $DIR/$program.in > $WORKDIR/output || return 1
+	stop=`date +%s%N`
+	time=`expr \( $stop - $start \) / 1000000`
+
+	if [ -z "$best" ] || [ $time -lt $best ]; then
+	    best=$time
+	    counts="- - -"
+
+	    if [ -n "$PERF" ]; then
+		counts=`awk -F, '$1 ~ /^[0-9]+$/ { printf "%s ", $1 }' $WORKDIR/perf`
+	    fi
+	fi
+
+	run=`expr $run + 1`
+    done
+
+    echo $best $counts
+}
+
+
+printf "%-8s %-6s %9s %8s %14s %14s %12s\n" program level ms "vs gcc" \
+    cycles instructions branch-miss | tee $LOG
+
+for program in $programs; do
+    if build $program gcc -O0 && result=`measure $program`; then
+	cp $WORKDIR/output $WORKDIR/expected
+	set -- $result
+	reference=$1
+	printf "%-8s %-6s %9s %8s %14s %14s %12s\n" $program "gcc-O0" $1 1.00 $2 $3 $4
+    else
+	echo "$program: gcc -m32 -O0 failed" 1>&2
+	continue
+    fi
+
+    for level in $LEVELS; do
+	if build $program scc $level && result=`measure $program`; then
+	    if cmp -s $WORKDIR/output $WORKDIR/expected; then
+		set -- $result
+		ratio=`echo $1 $reference | awk '{ printf "%.2f", ($2 > 0 ? $1 / $2 : 0) }'`
+		printf "%-8s %-6s %9s %8s %14s %14s %12s\n" $program $level $1 $ratio $2 $3 $4
+	    else
+		echo "$program: scc $level output differs from gcc -O0" 1>&2
+	    fi
+	else
+	    echo "$program: scc $level failed" 1>&2
+	fi
+    done
+done | tee -a $LOG
@@ -0,0 +1,176 @@
+/*
+ * File:	server.cpp
+ *
+ * Description:	This file contains the public and private function
+ *		definitions for running the Simple C compiler as a compile
+ *		server, which saves starting a new process for each source
+ *		file.
+ *
+ *		The server listens on a Unix socket.  A client connects,
+ *		sends the source text, and shuts down its side of the
+ *		connection.  The server replies with a line containing the
+ *		exit status and the length of the assembly code, then the
+ *		assembly code itself, and then any diagnostics until the
+ *		connection is closed.  Each request is translated from
+ *		scratch by one of the worker threads, so requests are
+ *		independent of each other.
+ */
+
+# include <string>
+# include <thread>
+# include <vector>
+# include <cerrno>
+# include <csignal>
+# include <cstdio>
+# include <cstring>
+# include <unistd.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+# include "compiler.h"
+# include "options.h"
+# include "server.h"
+
+using namespace std;
+
+
+/*
+ * Class:	Reply (private)
+ *
+ * Description:	A sink collecting the assembly code and diagnostics for
+ *		a single request.
+ */
+
+class Reply : public Sink {
+public:
+    string text, errors;
+
+    void write(const char *data, size_t length) override {
+	text.append(data, length);
+    }
+
+    void error(const char *data, size_t length) override {
+	errors.append(data, length);
+    }
+};
+
+
+/*
+ * Function:	send (private)
+ *
+ * Description:	Write the entire string to the socket, returning whether
+ *		it could be written.
+ */
+
+static bool send(int fd, const string &data)
+{
+    size_t sent = 0;
+    ssize_t n;
+
+
+    while (sent < data.size()) {
+	n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+
+	if (n < 0 && errno == EINTR)
+	    continue;
+
+	if (n <= 0)
+	    return false;
+
+	sent += n;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	serve (private)
+ *
+ * Description:	Read the source text of a request from a connected
+ *		socket, compile it, and send back the reply.
+ */
+
+static void serve(int fd)
+{
+    string source, header;
+    char buf[4096];
+    Reply reply;
+    ssize_t n;
+    bool ok;
+
+
+    while ((n = read(fd, buf, sizeof(buf))) != 0) {
+	if (n < 0 && errno == EINTR)
+	    continue;
+
+	if (n < 0)
+	    return;
+
+	source.append(buf, n);
+    }
+
+    ok = compile(source.data(), source.size(), reply);
+
+    if (!ok)
+	reply.text.clear();
+
+    header = to_string(ok ? EXIT_SUCCESS : EXIT_FAILURE) + " ";
+    header += to_string(reply.text.size()) + "\n";
+
+    if (send(fd, header) && send(fd, reply.text))
+	send(fd, reply.errors);
+}
+
+
+/*
+ * Function:	runServer
+ *
+ * Description:	Listen on the Unix socket with the given path and serve
+ *		requests forever, using the number of jobs requested as
+ *		the number of worker threads.  Return false only if the
+ *		socket could not be created.
+ */
+
+bool runServer(const string &path)
+{
+    struct sockaddr_un addr;
+    vector<thread> workers;
+    int listener;
+
+
+    if (path.size() >= sizeof(addr.sun_path)) {
+	fprintf(stderr, "scc: %s: socket path too long\n", path.c_str());
+	return false;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    unlink(path.c_str());
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listener < 0 || bind(listener, (struct sockaddr *) &addr, sizeof(addr)) < 0
+	    || listen(listener, SOMAXCONN) < 0) {
+	perror(path.c_str());
+	return false;
+    }
+
+    auto work = [listener]() {
+	int fd;
+
+	while (true) {
+	    if ((fd = accept(listener, nullptr, nullptr)) < 0)
+		continue;
+
+	    serve(fd);
+	    close(fd);
+	}
+    };
+
+    for (unsigned i = 1; i < jobs; i ++)
+	workers.push_back(thread(work));
+
+    work();
+    return true;
+}
@@ -0,0 +1,14 @@
+/*
+ * File:	server.h
+ *
+ * Description:	This file contains the function declarations for running
+ *		the Simple C compiler as a compile server.
+ */
+
+# ifndef SERVER_H
+# define SERVER_H
+# include <string>
+
+bool runServer(const std::string &path);
+
+# endif /* SERVER_H */
@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# startbench.sh - measure how long scc --run takes to start a program
+#
+# Each program in the examples directory is run on its input in two
+# ways, several times each, keeping the fastest run: compiled by scc to
+# assembly, assembled and linked with gcc -m32, and run, and compiled by
+# scc --run into memory and run at once.  The programs are small, so the
+# time is mostly that taken before the first instruction of the program.
+# The outputs of the two must match.  The table is also written to
+# startbench.log.
+#
+# usage: startbench.sh [program ...]
+#
+
+SCC=./scc
+DIR=examples
+LOG=startbench.log
+RUNS=${RUNS:-5}
+WORKDIR=${TMPDIR:-/tmp}/scc-startbench.$$
+
+trap 'rm -rf $WORKDIR' 0
+trap 'exit 1' 1 2 15
+mkdir -p $WORKDIR || exit 1
+
+programs=${*:-`cd $DIR && ls *.c | sed 's/\.c$//'`}
+
+
+# Run the given command several times with the input of the given
+# program, printing the time of the fastest run in milliseconds.  The
+# output of every run is kept in $WORKDIR/output.
+
+measure() {
+    program=$1
+    shift
+    best=
+    run=0
+
+    while [ $run -lt $RUNS ]; do
+	start=`date +%s%N`
+	sh -c "$*" < $DIR/$program.in > $WORKDIR/output 2> /dev/null
+	stop=`date +%s%N`
+	time=`expr \( $stop - $start \) / 1000000`
+
+	if [ -z "$best" ] || [ $time -lt $best ]; then
+	    best=$time
+	fi
+
+	run=`expr $run + 1`
+    done
+
+    echo $best
+}
+
+
+printf "%-8s %12s %12s %8s\n" program "scc+gcc ms" "--run ms" speedup | tee $LOG
+
+for program in $programs; do
+    pipeline="$SCC < $DIR/$program.c > $WORKDIR/a.s &&
+	gcc -m32 -o $WORKDIR/a.out $WORKDIR/a.s && $WORKDIR/a.out"
+
+    if $SCC < $DIR/$program.c 2> /dev/null > $WORKDIR/a.s &&
+	gcc -m32 -o $WORKDIR/a.out $WORKDIR/a.s 2> /dev/null; then
+	reference=`measure $program "$pipeline"`
+	cp $WORKDIR/output $WORKDIR/expected
+    else
+	echo "$program: scc+gcc -m32 failed" 1>&2
+	reference=-
+    fi
+
+    time=`measure $program "$SCC --run $DIR/$program.c"`
+
+    if [ $reference != - ] && ! cmp -s $WORKDIR/output $WORKDIR/expected; then
+	echo "$program: scc --run output differs from scc+gcc" 1>&2
+	continue
+    fi
+
+    speedup=`echo $reference $time | awk '{ printf "%s", ($1 == "-" || $2 == 0 ? "-" : sprintf("%.1f", $1 / $2)) }'`
+    printf "%-8s %12s %12s %8s\n" $program $reference $time $speedup
+done | tee -a $LOG
@@ -0,0 +1,145 @@
+/*
+ * File:	storage.cpp
+ *
+ * Description:	This file contains the public function definitions for
+ *		the storage of a single compilation.  The trees, scopes,
+ *		symbols, parameter lists, and labels of a translation unit
+ *		point at each other freely, and any of them may be dropped
+ *		or replaced along the way, so no one of them owns the
+ *		others.  Instead, each is obtained from the storage of the
+ *		compilation running on its thread, and whatever is still
+ *		alive when the compilation is finished is destroyed then.
+ *		A compile server would otherwise grow with every request.
+ *
+ *		Each object is preceded by a pointer to its entry in the
+ *		storage, so that it can be discarded early from any thread.
+ *		Threads helping with a compilation must use its storage,
+ *		which is why the entries are locked.  Objects obtained with
+ *		no storage open have no entry and are never destroyed,
+ *		which is all that is needed by a compiler that exits when
+ *		done.  The pointer keeps the objects aligned only as well
+ *		as a pointer, which is all that any of them need.
+ */
+
+# include <deque>
+# include <mutex>
+# include <new>
+# include "storage.h"
+
+using namespace std;
+
+struct Entry {
+    void *object;
+    Destroyer destroy;
+    Storage *storage;
+};
+
+class Storage {
+public:
+    mutex lock;
+    deque<Entry> entries;
+};
+
+static thread_local Storage *current;
+
+
+/*
+ * Function:	obtain
+ *
+ * Description:	Allocate an object of the given size from the storage of
+ *		this thread, to be destroyed by the given function if it
+ *		is still alive when the storage is closed.
+ */
+
+void *obtain(size_t size, Destroyer destroy)
+{
+    Entry **header = static_cast<Entry **>(::operator new(sizeof(Entry *) + size));
+    void *object = header + 1;
+
+
+    *header = nullptr;
+
+    if (current != nullptr) {
+	lock_guard<mutex> guard(current->lock);
+
+	current->entries.push_back({object, destroy, current});
+	*header = &current->entries.back();
+    }
+
+    return object;
+}
+
+
+/*
+ * Function:	discard
+ *
+ * Description:	Free an object obtained from some storage, which need not
+ *		be that of this thread.
+ */
+
+void discard(void *object)
+{
+    Entry **header = static_cast<Entry **>(object) - 1;
+    Entry *entry = *header;
+
+
+    if (entry != nullptr) {
+	lock_guard<mutex> guard(entry->storage->lock);
+	entry->object = nullptr;
+    }
+
+    ::operator delete(header);
+}
+
+
+/*
+ * Function:	openStorage
+ *
+ * Description:	Create the storage for a new compilation and make it the
+ *		storage of this thread.
+ */
+
+Storage *openStorage()
+{
+    current = new Storage();
+    return current;
+}
+
+
+/*
+ * Function:	closeStorage
+ *
+ * Description:	Destroy every object still alive in the given storage,
+ *		and then the storage itself.  Any threads that used it
+ *		must have finished by now.
+ */
+
+void closeStorage(Storage *storage)
+{
+    for (auto &entry : storage->entries)
+	if (entry.object != nullptr)
+	    entry.destroy(entry.object);
+
+    if (current == storage)
+	current = nullptr;
+
+    delete storage;
+}
+
+
+/*
+ * Functions:	currentStorage, useStorage
+ *
+ * Description:	Get and set the storage of this thread, so that a thread
+ *		helping with a compilation can use the same storage.
+ */
+
+Storage *currentStorage()
+{
+    return current;
+}
+
+void useStorage(Storage *storage)
+{
+    current = storage;
+}
@@ -0,0 +1,31 @@
+/*
+ * File:	storage.h
+ *
+ * Description:	This file contains the function declarations for the
+ *		storage of a single compilation, which is freed all at
+ *		once when the compilation is finished.
+ */
+
+# ifndef STORAGE_H
+# define STORAGE_H
+# include <cstddef>
+
+class Storage;
+
+typedef void (*Destroyer)(void *object);
+
+void *obtain(size_t size, Destroyer destroy);
+void discard(void *object);
+
+Storage *openStorage();
+void closeStorage(Storage *storage);
+Storage *currentStorage();
+void useStorage(Storage *storage);
+
+template<class T>
+void destroy(void *object)
+{
+    delete static_cast<T *>(object);
+}
+
+# endif /* STORAGE_H */
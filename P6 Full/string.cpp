@@ -140,7 +140,9 @@ string parseString(const string &s)
  * Function:	escapeString
  *
  * Description:	Return a copy of the given string but with any unprintable
- *		character replaced with an octal escape sequence.
+ *		character, quote, or backslash replaced with an octal
+ *		escape sequence, so that parsing the copy gives the string
+ *		back and the copy may be written as is by the assembler.
  */
 
 string escapeString(const string &s)
@@ -150,7 +152,7 @@ string escapeString(const string &s)
 
 
     for (unsigned i = 0; i < s.size(); i ++)
-	if (!isprint(s[i])) {
+	if (!isprint(s[i]) || s[i] == '"' || s[i] == '\\') {
 	    sprintf(buf, "\\%03o", (unsigned char) s[i]);
 	    result += buf;
 	} else
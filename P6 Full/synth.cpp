@@ -0,0 +1,276 @@
+/*
+ * File:	synth.cpp
+ *
+ * Description:	This file contains a generator of synthetic Simple C
+ *		programs for measuring how the compiler scales.  The program
+ *		written to the standard output is determined entirely by the
+ *		options, so the same options always give the same program.
+ *
+ *		-s SEED		the seed for choosing expressions (default 1)
+ *		-f N		the number of functions (default 200)
+ *		-n N		the number of statements in each function
+ *				(default 20)
+ *		-d N		the depth of each expression (default 4)
+ *		-g N		the number of global variables (default 20)
+ *		-l N		the number of string literals, spread among
+ *				the functions (default 20)
+ *		-k N		the depth of the nested statements in each
+ *				function (default 3)
+ *
+ *		Each function takes two parameters and declares a local
+ *		variable for each level of nesting.  Its statements assign
+ *		expressions to its locals and to globals, call earlier
+ *		functions, and print its string literals.  The nested
+ *		statements alternate between if-else and while statements
+ *		and are all placed in the middle of the function.
+ */
+
+# include <string>
+# include <cstdlib>
+# include <cstring>
+# include <iostream>
+
+using namespace std;
+
+static unsigned long seed = 1;
+static unsigned functions = 200, statements = 20, depth = 4;
+static unsigned globals = 20, strings = 20, nesting = 3;
+
+static unsigned current, locals, assignable;
+
+
+/*
+ * Function:	random (private)
+ *
+ * Description:	Return a pseudorandom number less than the given bound.
+ *		We use our own generator so that the programs are the same
+ *		on every system.
+ */
+
+static unsigned random(unsigned bound)
+{
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    return (seed >> 33) % bound;
+}
+
+
+/*
+ * Function:	variable (private)
+ *
+ * Description:	Return the name of a variable that may be assigned, which
+ *		is either a global variable or a local variable not used
+ *		as the counter of an enclosing loop.
+ */
+
+static string variable()
+{
+    if (globals > 0 && random(4) == 0)
+	return "g" + to_string(random(globals));
+
+    return "x" + to_string(random(assignable));
+}
+
+
+/*
+ * Function:	leaf (private)
+ *
+ * Description:	Return an expression with no operators.
+ */
+
+static string leaf()
+{
+    switch (random(4)) {
+    case 0:
+	return to_string(random(100));
+
+    case 1:
+	return random(2) ? "a" : "b";
+
+    default:
+	return variable();
+    }
+}
+
+
+/*
+ * Function:	expression (private)
+ *
+ * Description:	Return an expression of the given depth.  One operand
+ *		always has the remaining depth, and the other is shallow, so
+ *		the size of an expression grows linearly with its depth.
+ */
+
+static string expression(unsigned n)
+{
+    static const char *operators[] = {" + ", " - ", " * ", " < ", " == ", " && "};
+    string deep, shallow;
+
+
+    if (n == 0)
+	return leaf();
+
+    deep = expression(n - 1);
+    shallow = expression(random(n < 3 ? n : 3));
+
+    if (random(2))
+	swap(deep, shallow);
+
+    return "(" + deep + operators[random(6)] + shallow + ")";
+}
+
+
+/*
+ * Function:	statement (private)
+ *
+ * Description:	Write a simple statement, which is either an assignment or
+ *		a call to an earlier function.
+ */
+
+static void statement(const string &indent)
+{
+    if (current > 0 && random(4) == 0) {
+	cout << indent << variable() << " = f" << random(current) << "(";
+	cout << expression(depth / 2) << ", " << expression(depth / 2) << ");" << endl;
+    } else
+	cout << indent << variable() << " = " << expression(depth) << ";" << endl;
+}
+
+
+/*
+ * Function:	nested (private)
+ *
+ * Description:	Write the nested statements starting at the given level.
+ *		A while statement counts down the last local variable not
+ *		yet used as a counter, which is then no longer assigned by
+ *		the statements within the loop.
+ */
+
+static void nested(unsigned level, const string &indent)
+{
+    string counter = "x" + to_string(locals - level - 1);
+    unsigned saved = assignable;
+
+
+    if (level == nesting)
+	return;
+
+    if (level % 2 == 0) {
+	cout << indent << "if (" << expression(depth) << ") {" << endl;
+	statement(indent + "    ");
+	nested(level + 1, indent + "    ");
+	cout << indent << "} else" << endl;
+	statement(indent + "    ");
+    } else {
+	cout << indent << counter << " = 3;" << endl;
+	cout << indent << "while (" << counter << " > 0) {" << endl;
+	assignable = locals - level - 1;
+	statement(indent + "    ");
+	nested(level + 1, indent + "    ");
+	assignable = saved;
+	cout << indent << "    " << counter << " = " << counter << " - 1;" << endl;
+	cout << indent << "}" << endl;
+    }
+}
+
+
+/*
+ * Function:	function (private)
+ *
+ * Description:	Write the definition of the current function.
+ */
+
+static void function()
+{
+    locals = assignable = nesting + 1;
+    cout << endl << "int f" << current << "(int a, int b)" << endl << "{" << endl;
+    cout << "    int x0";
+
+    for (unsigned i = 1; i < locals; i ++)
+	cout << ", x" << i;
+
+    cout << ";" << endl << endl;
+
+    for (unsigned i = 0; i < locals; i ++)
+	cout << "    x" << i << " = " << leaf() << ";" << endl;
+
+    for (unsigned i = 0; i < statements; i ++) {
+	if (i == statements / 2)
+	    nested(0, "    ");
+
+	statement("    ");
+    }
+
+    for (unsigned i = current; i < strings; i += functions)
+	cout << "    printf(\"f" << current << " string " << i << ": %d\\n\", x0);" << endl;
+
+    cout << "    return " << expression(depth) << ";" << endl << "}" << endl;
+}
+
+
+/*
+ * Function:	usage (private)
+ *
+ * Description:	Report an invalid option to the standard error and exit.
+ */
+
+static void usage(const char *arg)
+{
+    cerr << "synth: unrecognized option '" << arg << "'" << endl;
+    cerr << "usage: synth [-s SEED] [-f N] [-n N] [-d N] [-g N] [-l N] [-k N]" << endl;
+    exit(EXIT_FAILURE);
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Parse the options and write the program.  The function
+ *		main calls the last function defined.
+ */
+
+int main(int argc, char *argv[])
+{
+    unsigned long value;
+    char *end;
+
+
+    for (int i = 1; i < argc; i ++) {
+	if (argv[i][0] != '-' || strlen(argv[i]) != 2 || i + 1 == argc)
+	    usage(argv[i]);
+
+	value = strtoul(argv[i + 1], &end, 10);
+
+	if (*end != '\0')
+	    usage(argv[i + 1]);
+
+	switch (argv[i ++][1]) {
+	case 's': seed = value; break;
+	case 'f': functions = value; break;
+	case 'n': statements = value; break;
+	case 'd': depth = value; break;
+	case 'g': globals = value; break;
+	case 'l': strings = value; break;
+	case 'k': nesting = value; break;
+	default: usage(argv[i - 1]);
+	}
+    }
+
+    if (functions == 0)
+	usage("-f 0");
+
+    cout << "/* synth -s " << seed << " -f " << functions << " -n " << statements;
+    cout << " -d " << depth << " -g " << globals << " -l " << strings;
+    cout << " -k " << nesting << " */" << endl << endl;
+    cout << "int printf();" << endl;
+
+    for (unsigned i = 0; i < globals; i ++)
+	cout << "int g" << i << ";" << endl;
+
+    for (current = 0; current < functions; current ++)
+	function();
+
+    cout << endl << "int main(void)" << endl << "{" << endl;
+    cout << "    printf(\"%d\\n\", f" << functions - 1 << "(1, 2));" << endl;
+    cout << "}" << endl;
+    return 0;
+}
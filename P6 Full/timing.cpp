@@ -0,0 +1,249 @@
+/*
+ * File:	timing.cpp
+ *
+ * Description:	This file contains the public and member function
+ *		definitions for timing the phases of the compiler and
+ *		counting what it does, which are reported with
+ *		-ftime-report.  Nothing is done unless that option is
+ *		given.
+ *
+ *		The phases nest, since the parser calls the lexer and the
+ *		checker, so each thread keeps track of its current phase
+ *		and time is charged only to the innermost phase.  Time
+ *		spent by several threads is added together.  Any time not
+ *		charged to a phase, such as reading options or writing the
+ *		output, is reported as other.
+ *
+ *		The AST nodes are counted by class once all translation is
+ *		done, which means we must keep track of every node still
+ *		alive, since its class is not known while it is being
+ *		constructed.
+ */
+
+# include <map>
+# include <mutex>
+# include <atomic>
+# include <string>
+# include <cstdio>
+# include <cstdlib>
+# include <typeinfo>
+# include <cxxabi.h>
+# include <unordered_set>
+# include <sys/resource.h>
+# include "options.h"
+# include "timing.h"
+# include "Tree.h"
+
+using namespace std;
+using namespace std::chrono;
+
+static const char *phases[] = {
+    "lexing", "parsing", "checking", "optimizing", "allocating", "generating",
+    "assembling", "loading"
+};
+
+static const char *counters[] = {
+    "tokens", "symbols", "spills", "instructions", "literal bytes",
+    "shared bytes"
+};
+
+static const steady_clock::time_point started = steady_clock::now();
+
+static atomic<long long> elapsed[PHASES];
+static atomic<unsigned long> totals[COUNTERS];
+
+static thread_local Phase current = NO_PHASE;
+static thread_local steady_clock::time_point since;
+
+static mutex nodelock;
+static unordered_set<const Node *> nodes;
+
+
+/*
+ * Function:	charge (private)
+ *
+ * Description:	Charge the time since the last change of phase to the
+ *		current phase, if any.
+ */
+
+static void charge(steady_clock::time_point now)
+{
+    if (current != NO_PHASE)
+	elapsed[current] += duration_cast<nanoseconds>(now - since).count();
+
+    since = now;
+}
+
+
+/*
+ * Function:	PhaseTimer::PhaseTimer (constructor)
+ *
+ * Description:	Enter the given phase until this timer is destroyed.
+ */
+
+PhaseTimer::PhaseTimer(Phase phase)
+{
+    if (!time_report)
+	return;
+
+    charge(steady_clock::now());
+    _enclosing = current;
+    current = phase;
+}
+
+
+/*
+ * Function:	PhaseTimer::~PhaseTimer (destructor)
+ *
+ * Description:	Return to the enclosing phase.
+ */
+
+PhaseTimer::~PhaseTimer()
+{
+    if (!time_report)
+	return;
+
+    charge(steady_clock::now());
+    current = _enclosing;
+}
+
+
+/*
+ * Function:	count
+ *
+ * Description:	Add to one of the counters.
+ */
+
+void count(Counter counter, unsigned long amount)
+{
+    if (time_report)
+	totals[counter] += amount;
+}
+
+
+/*
+ * Functions:	countNode, forgetNode
+ *
+ * Description:	Keep track of an AST node being constructed or destroyed.
+ */
+
+void countNode(const Node *node)
+{
+    if (time_report) {
+	lock_guard<mutex> guard(nodelock);
+	nodes.insert(node);
+    }
+}
+
+void forgetNode(const Node *node)
+{
+    if (time_report) {
+	lock_guard<mutex> guard(nodelock);
+	nodes.erase(node);
+    }
+}
+
+
+/*
+ * Function:	classify (private)
+ *
+ * Description:	Return the number of AST nodes alive of each class.
+ */
+
+static map<string, unsigned long> classify()
+{
+    map<string, unsigned long> classes;
+    char *name;
+    int status;
+
+
+    lock_guard<mutex> guard(nodelock);
+
+    for (auto node : nodes) {
+	const char *mangled = typeid(*node).name();
+
+	name = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+	classes[status == 0 ? name : mangled] ++;
+	free(name);
+    }
+
+    return classes;
+}
+
+
+/*
+ * Function:	printTimeReport
+ *
+ * Description:	Write the report, either as a table or as JSON on a
+ *		single line, depending on the option given.
+ */
+
+void printTimeReport(ostream &ostr)
+{
+    map<string, unsigned long> classes = classify();
+    double seconds[PHASES], total, other;
+    struct rusage usage;
+    unsigned long live = 0;
+    char buf[100];
+
+
+    total = duration_cast<duration<double>>(steady_clock::now() - started).count();
+    other = total;
+
+    for (unsigned i = 0; i < PHASES; i ++) {
+	seconds[i] = elapsed[i] / 1e9;
+	other -= seconds[i];
+    }
+
+    for (auto &entry : classes)
+	live += entry.second;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    if (time_report_json) {
+	ostr << "{\"phases\": {";
+
+	for (unsigned i = 0; i < PHASES; i ++)
+	    ostr << "\"" << phases[i] << "\": " << seconds[i] << ", ";
+
+	ostr << "\"other\": " << other << ", \"total\": " << total << "}";
+	ostr << ", \"counters\": {";
+
+	for (unsigned i = 0; i < COUNTERS; i ++)
+	    ostr << "\"" << counters[i] << "\": " << totals[i] << ", ";
+
+	ostr << "\"nodes\": " << live << "}, \"classes\": {";
+
+	for (auto it = classes.begin(); it != classes.end(); ++ it)
+	    ostr << (it != classes.begin() ? ", " : "") << "\"" << it->first << "\": " << it->second;
+
+	ostr << "}, \"peak_rss_kb\": " << usage.ru_maxrss << "}" << endl;
+	return;
+    }
+
+    ostr << "Time report:" << endl;
+
+    for (unsigned i = 0; i <= PHASES + 1; i ++) {
+	const char *name = i < PHASES ? phases[i] : i == PHASES ? "other" : "total";
+	double value = i < PHASES ? seconds[i] : i == PHASES ? other : total;
+
+	snprintf(buf, sizeof(buf), "  %-16s %10.3f s %6.1f%%", name, value, total > 0 ? 100 * value / total : 0);
+	ostr << buf << endl;
+    }
+
+    for (unsigned i = 0; i < COUNTERS; i ++) {
+	snprintf(buf, sizeof(buf), "  %-16s %10lu", counters[i], totals[i].load());
+	ostr << buf << endl;
+    }
+
+    snprintf(buf, sizeof(buf), "  %-16s %10lu", "AST nodes", live);
+    ostr << buf << endl;
+
+    for (auto &entry : classes) {
+	snprintf(buf, sizeof(buf), "    %-14s %10lu", entry.first.c_str(), entry.second);
+	ostr << buf << endl;
+    }
+
+    snprintf(buf, sizeof(buf), "  %-16s %10ld KB", "peak RSS", usage.ru_maxrss);
+    ostr << buf << endl;
+}
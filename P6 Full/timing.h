@@ -0,0 +1,39 @@
+/*
+ * File:	timing.h
+ *
+ * Description:	This file contains the class and function declarations
+ *		for timing the phases of the compiler and counting what it
+ *		does, which are reported with -ftime-report.
+ */
+
+# ifndef TIMING_H
+# define TIMING_H
+# include <chrono>
+# include <ostream>
+
+enum Phase {
+    LEXING, PARSING, CHECKING, OPTIMIZING, ALLOCATING, GENERATING, ASSEMBLING,
+    LOADING,
+    PHASES,
+    NO_PHASE = PHASES
+};
+
+enum Counter {
+    TOKENS, SYMBOLS, SPILLS, INSTRUCTIONS, LITERAL_BYTES, SHARED_BYTES,
+    COUNTERS
+};
+
+class PhaseTimer {
+    Phase _enclosing;
+
+public:
+    PhaseTimer(Phase phase);
+    ~PhaseTimer();
+};
+
+void count(Counter counter, unsigned long amount = 1);
+void countNode(const class Node *node);
+void forgetNode(const class Node *node);
+void printTimeReport(std::ostream &ostr);
+
+# endif /* TIMING_H */
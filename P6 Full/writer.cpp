@@ -66,6 +66,16 @@ void Call::write(ostream &ostr) const
     ostr << ")";
 }
 
+void Inline::write(ostream &ostr) const
+{
+    ostr << "(inline " << _id->name();
+
+    for (unsigned i = 0; i < _params.size(); i ++)
+	ostr << " " << _params[i];
+
+    ostr << " " << _body << ")";
+}
+
 void Not::write(ostream &ostr) const
 {
     ostr << "(! " << _expr << ")";
@@ -169,6 +179,9 @@ void Block::write(ostream &ostr) const
 {
     ostr << "(begin";
 
+    for (auto symbol : _decls->symbols())
+	ostr << " (declare " << symbol->type() << " " << symbol->name() << ")";
+
     for (unsigned i = 0; i < _stmts.size(); i ++)
 	ostr << " " << _stmts[i];
 
@@ -183,7 +196,7 @@ void While::write(ostream &ostr) const
 void For::write(ostream &ostr) const
 {
     ostr << "(for " << _init << " " << _expr;
-    ostr << " " << _stmt << ")";
+    ostr << " " << _incr << " " << _stmt << ")";
 }
 
 void If::write(ostream &ostr) const